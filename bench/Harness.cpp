@@ -0,0 +1,148 @@
+#include "bench/Harness.hpp"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <fstream>
+
+#include "phylokit/TreeGenerator.hpp"
+
+namespace {
+
+std::string json_string(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+std::string subtree(const std::vector<std::string> &names, size_t lo,
+                    size_t hi) {
+  if (hi - lo == 1) {
+    return names[lo];
+  }
+  size_t mid = (lo + hi) / 2;
+  return "(" + subtree(names, lo, mid) + "," + subtree(names, mid, hi) + ")";
+}
+
+}  // namespace
+
+size_t uniform(std::mt19937 &rng, size_t n) {
+  return rng() % n;
+}
+
+Harness::Harness(double min_seconds, const std::string &filter)
+    : min_seconds(min_seconds), filter(filter) {}
+
+void Harness::run(const std::string &name, size_t size,
+                  const std::function<size_t()> &f) {
+  if (name.find(filter) == std::string::npos) {
+    return;
+  }
+  reset_peak_rss();
+  Result r = {name, size, 0, 0, 0, 0};
+  auto start = std::chrono::steady_clock::now();
+  do {
+    r.items += f();
+    r.runs++;
+    r.seconds = seconds_since(start);
+  } while (r.seconds < min_seconds);
+  r.peak_rss_kb = peak_rss_kb();
+  std::cerr << name << "/" << size << ": " << r.seconds / r.runs << " s"
+            << std::endl;
+  results.push_back(r);
+}
+
+void Harness::config(const std::string &key, double value) {
+  configs.emplace_back(key, value);
+}
+
+void Harness::write_json(std::ostream &out) const {
+  out << "{\n  \"config\": {";
+  for (size_t i = 0; i < configs.size(); i++) {
+    out << (i ? ", " : "") << json_string(configs[i].first) << ": "
+        << configs[i].second;
+  }
+  out << "},\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    out << (i ? "," : "") << "\n    {\"name\": " << json_string(r.name)
+        << ", \"size\": " << r.size << ", \"runs\": " << r.runs
+        << ", \"seconds_per_run\": " << r.seconds / r.runs
+        << ", \"items_per_run\": " << r.items / r.runs
+        << ", \"items_per_second\": " << r.items / r.seconds
+        << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}";
+  }
+  out << "\n  ]\n}" << std::endl;
+}
+
+long peak_rss_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stol(line.substr(6));
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void reset_peak_rss() {
+  // Linux resets VmHWM to the current RSS on this write; elsewhere the peak
+  // stays the peak of the whole process.
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs) {
+    clear_refs << "5" << std::endl;
+  }
+}
+
+std::vector<std::string> taxon_names(int n) {
+  std::vector<std::string> names;
+  for (int i = 0; i < n; i++) {
+    names.push_back("t" + std::to_string(i));
+  }
+  return names;
+}
+
+TaxonSet taxon_set(const std::vector<std::string> &names) {
+  TaxonSet ts(names.size());
+  for (const std::string &name : names) {
+    ts.add(name);
+  }
+  return ts;
+}
+
+std::vector<std::string> yule_trees(const TaxonSet &ts, int ntrees,
+                                    uint64_t seed) {
+  TreeGenerator gen(ts, seed);
+  std::vector<std::string> trees(ntrees);
+  for (std::string &tree : trees) {
+    gen.write_newick(gen.yule(), tree, false);
+  }
+  return trees;
+}
+
+std::vector<std::string> gene_trees(const TaxonSet &ts, int ntrees,
+                                    uint64_t seed, double scale) {
+  TreeGenerator gen(ts, seed);
+  SimTree species = gen.yule();
+  std::vector<std::string> trees(ntrees);
+  for (std::string &tree : trees) {
+    gen.write_newick(gen.coalescent(species, scale), tree, false);
+  }
+  return trees;
+}
+
+std::string balanced_tree(const std::vector<std::string> &names) {
+  return subtree(names, 0, names.size()) + ";";
+}
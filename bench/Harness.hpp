@@ -0,0 +1,76 @@
+#ifndef BENCH_HARNESS_HPP__
+#define BENCH_HARNESS_HPP__
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "phylokit/TaxonSet.hpp"
+
+// Runs named benchmark cases and reports them as JSON. Each case is run
+// until it has taken at least min_seconds, and records its time per run,
+// the items (trees, operations, ...) it processed per second, and the peak
+// resident set size of the process while it ran.
+class Harness {
+ public:
+  // Cases whose names do not contain filter are skipped.
+  Harness(double min_seconds, const std::string &filter);
+
+  // f does one run and returns the number of items it processed. size is
+  // the input size the case was run at, usually taxa or bits.
+  void run(const std::string &name, size_t size,
+           const std::function<size_t()> &f);
+
+  // Adds a key to the "config" object of the report.
+  void config(const std::string &key, double value);
+  void write_json(std::ostream &out) const;
+
+ private:
+  struct Result {
+    std::string name;
+    size_t size;
+    size_t runs;
+    size_t items;
+    double seconds;
+    long peak_rss_kb;
+  };
+
+  double min_seconds;
+  std::string filter;
+  std::vector<std::pair<std::string, double>> configs;
+  std::vector<Result> results;
+};
+
+// The peak resident set size of the process in KB, since the last
+// reset_peak_rss() where the kernel supports resetting it.
+long peak_rss_kb();
+void reset_peak_rss();
+
+// Seconds on the steady clock since start, for benchmarks that time their
+// phases once rather than through Harness::run.
+double seconds_since(std::chrono::steady_clock::time_point start);
+
+// Deterministic inputs: taxon names t0, t1, ... and newick trees over them.
+// Random trees come from a TreeGenerator, and uniform() uses only the raw
+// output of std::mt19937, which the standard fixes, so a seed gives the same
+// inputs with every standard library.
+//
+// A number in [0, n), with a bias too small to matter here.
+size_t uniform(std::mt19937 &rng, size_t n);
+std::vector<std::string> taxon_names(int n);
+TaxonSet taxon_set(const std::vector<std::string> &names);
+// ntrees independent Yule trees over the taxa of ts.
+std::vector<std::string> yule_trees(const TaxonSet &ts, int ntrees,
+                                    uint64_t seed);
+// ntrees coalescent gene trees inside one Yule species tree over the taxa
+// of ts, whose branches are scaled by scale. Larger scales give gene trees
+// that share more of their clades.
+std::vector<std::string> gene_trees(const TaxonSet &ts, int ntrees,
+                                    uint64_t seed, double scale);
+// Splits names in half, recursively.
+std::string balanced_tree(const std::vector<std::string> &names);
+
+#endif  // BENCH_HARNESS_HPP__
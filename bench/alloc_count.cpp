@@ -0,0 +1,68 @@
+// Counts heap allocations made by clade construction and set algebra for
+// gene-tree sized taxon sets. Run it before and after a change to the
+// BitVectorFixed storage to see how many mallocs a workload pays for.
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/Clade.hpp"
+#include "phylokit/newick.hpp"
+
+static size_t allocations = 0;
+
+void *operator new(size_t sz) {
+  allocations++;
+  void *p = malloc(sz ? sz : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main() {
+  int iterations = 1000;
+  std::cout << "taxa\tclade_ops\tnewick_to_clades\tnewick_to_treeclades"
+            << std::endl;
+
+  for (int n : {50, 100, 250, 256, 257, 1000}) {
+    std::vector<std::string> names = taxon_names(n);
+    TaxonSet ts = taxon_set(names);
+    std::string newick = balanced_tree(names);
+    Clade a(ts), b(ts, "t0,t1,t2");
+    for (int i = 0; i < n / 2; i++) {
+      a.add(i);
+    }
+
+    size_t before = allocations;
+    for (int i = 0; i < iterations; i++) {
+      Clade c(a);
+      c += b;
+      Clade d = c - b;
+      Clade e = d.complement();
+      Clade f = e.overlap(a);
+      c = f;
+    }
+    size_t clade_ops = allocations - before;
+
+    before = allocations;
+    std::unordered_set<Clade> clades;
+    newick_to_clades(newick, ts, clades);
+    size_t parse_clades = allocations - before;
+
+    before = allocations;
+    {
+      Tree tree = newick_to_treeclades(newick, ts);
+    }
+    size_t parse_tree = allocations - before;
+
+    std::cout << n << "\t" << clade_ops / iterations << "\t" << parse_clades
+              << "\t" << parse_tree << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Collect-then-deduplicate throughput for the clades of many gene trees, with
+// a hash set and with a radix-sorted CladeSet.
+//
+//   clade_dedup -i genetrees.tre        trees of a newick file
+//   clade_dedup -n 100 -t 100000 -s 7   random trees instead
+//   clade_dedup -c 0.1                   gene trees that share fewer clades
+//
+// The trees are parsed into one vector of clades first, timed on its own.
+// The hash set then inserts every clade, and the CladeSet buffers them and
+// sorts and deduplicates them in batches. Both then look up every distinct
+// clade once.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/CladeSet.hpp"
+#include "phylokit/newick.hpp"
+#include "phylokit/util/Options.hpp"
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string input, arg;
+  int ntaxa = 100, ntrees = 100000, seed = 1;
+  double scale = 1;
+  Options::get("i input", &input);
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("t trees", &arg)) ntrees = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoi(arg);
+  if (Options::get("c scale", &arg)) scale = std::stod(arg);
+
+  TaxonSet ts = taxon_set(taxon_names(ntaxa));
+  std::vector<std::string> trees;
+  if (input.size()) {
+    std::ifstream in(input);
+    std::string line;
+    std::unordered_set<std::string> names;
+    while (std::getline(in, line)) {
+      if (line.find('(') == std::string::npos) continue;
+      trees.push_back(line);
+      newick_to_ts(line, names);
+    }
+    ts = taxon_set(std::vector<std::string>(names.begin(), names.end()));
+  } else {
+    // Gene trees of one species tree share many clades; -c scales the
+    // species tree, and with it how many.
+    trees = gene_trees(ts, ntrees, seed, scale);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Clade> parsed;
+  for (const std::string &tree : trees) {
+    newick_to_clades(tree, ts, parsed);
+  }
+  double parse = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  std::unordered_set<Clade> hashed;
+  for (const Clade &c : parsed) {
+    hashed.insert(c);
+  }
+  double hash_build = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  size_t found = 0;
+  for (const Clade &c : hashed) {
+    found += hashed.count(c);
+  }
+  double hash_lookup = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  CladeSet sorted(ts);
+  for (const Clade &c : parsed) {
+    sorted.insert(c);
+  }
+  sorted.build();
+  double sorted_build = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  for (const Clade &c : sorted) {
+    found += sorted.contains(c);
+  }
+  double sorted_lookup = seconds_since(start);
+
+  if (found != hashed.size() + sorted.size() ||
+      hashed.size() != sorted.size()) {
+    std::cerr << "clade sets disagree" << std::endl;
+    return 1;
+  }
+  std::cout << "parse_s\t" << parse << std::endl;
+  std::cout << "set\ttrees\ttaxa\tclades\tdistinct\tbuild_s\tlookup_s"
+            << std::endl;
+  auto row = [&](const char *set, double build, double lookup) {
+    std::cout << set << "\t" << trees.size() << "\t" << ts.size() << "\t"
+              << parsed.size() << "\t" << sorted.size() << "\t" << build
+              << "\t" << lookup << std::endl;
+  };
+  row("unordered_set", hash_build, hash_lookup);
+  row("CladeSet", sorted_build, sorted_lookup);
+  return 0;
+}
@@ -0,0 +1,109 @@
+// Measures how well clade hashes spread over a set of gene tree clades.
+//
+//   clade_hash -i genetrees.tre        clades of the trees in a newick file
+//   clade_hash -n 200 -t 1000 -s 7     clades of random trees instead
+//
+// For the current BitVectorFixed hash and the previous XOR-of-words hash it
+// reports how many distinct clades share a full 64-bit hash value, and the
+// mean number of other clades found in a clade's bucket of a power-of-two
+// table with at least one bucket per clade, next to what a uniform hash
+// would give.
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/Clade.hpp"
+#include "phylokit/newick.hpp"
+#include "phylokit/util/Options.hpp"
+
+namespace {
+
+size_t xor_words_hash(const Clade &c) {
+  const BitVectorFixed &bits = c.get_taxa();
+  std::vector<elem_type> words((bits.size + 63) / 64 + 1, 0);
+  for (Taxon t : c) {
+    words[t / 64] |= (elem_type) 1 << (t % 64);
+  }
+  size_t h = 0;
+  std::hash<elem_type> hasher;
+  for (elem_type w : words) {
+    h ^= hasher(w);
+  }
+  return h;
+}
+
+void report(const std::string &name, const std::vector<size_t> &hashes) {
+  std::unordered_map<size_t, size_t> full;
+  size_t buckets = 1;
+  while (buckets < hashes.size()) buckets *= 2;
+  std::vector<size_t> load(buckets, 0);
+  for (size_t h : hashes) {
+    full[h]++;
+    load[h & (buckets - 1)]++;
+  }
+  size_t colliding = 0;
+  for (auto &kv : full) {
+    if (kv.second > 1) colliding += kv.second;
+  }
+  double neighbours = 0;
+  size_t worst = 0;
+  for (size_t l : load) {
+    neighbours += (double) l * (l - 1);
+    worst = std::max(worst, l);
+  }
+  std::cout << name << "\t" << hashes.size() << "\t" << full.size() << "\t"
+            << colliding << "\t" << neighbours / hashes.size() << "\t"
+            << (hashes.size() - 1.0) / buckets << "\t" << worst << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string input, arg;
+  int ntaxa = 200, ntrees = 1000, seed = 1;
+  Options::get("i input", &input);
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("t trees", &arg)) ntrees = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoi(arg);
+
+  TaxonSet ts = taxon_set(taxon_names(ntaxa));
+  std::vector<std::string> trees;
+  if (input.size()) {
+    std::ifstream in(input);
+    std::string line;
+    std::unordered_set<std::string> names;
+    while (std::getline(in, line)) {
+      if (line.find('(') == std::string::npos) continue;
+      trees.push_back(line);
+      newick_to_ts(line, names);
+    }
+    ts = taxon_set(std::vector<std::string>(names.begin(), names.end()));
+  } else {
+    trees = yule_trees(ts, ntrees, seed);
+  }
+  std::unordered_set<Clade> clades;
+  for (const std::string &tree : trees) {
+    newick_to_clades(tree, ts, clades);
+  }
+
+  std::vector<size_t> current, legacy;
+  for (const Clade &c : clades) {
+    current.push_back(c.hash());
+    legacy.push_back(xor_words_hash(c));
+  }
+
+  std::cout << "hash\tclades\tdistinct_hashes\tclades_in_full_collisions\t"
+            << "mean_bucket_neighbours\tuniform_expectation\tmax_bucket"
+            << std::endl;
+  report("xor_words", legacy);
+  report("current", current);
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Writes random trees in newick, one per line, for scaling runs: the same
+// options and seed always give the same file.
+//
+//   generate -n 1000 -t 1000000 -m coalescent -x 0.1 -p 0.05 -l -o genes.tre
+//
+// -m is yule, caterpillar or coalescent. Coalescent gene trees are drawn
+// inside one Yule species tree, scaled by -c and written to -S if given.
+// -x drops taxa and -p contracts internal branches with the given
+// probabilities, per tree; -l adds branch lengths and -L sets the prefix of
+// the taxon names.
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "phylokit/TreeGenerator.hpp"
+#include "phylokit/util/Options.hpp"
+
+namespace {
+
+const size_t flush_bytes = 1 << 20;
+
+void flush(std::string &buf, std::ostream &out) {
+  out.write(buf.data(), buf.size());
+  buf.clear();
+}
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string arg;
+  int ntaxa = 100, ntrees = 1000;
+  uint64_t seed = 1;
+  double polytomy = 0, missing = 0, scale = 1;
+  std::string model = "yule", prefix = "t", output, species_output;
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("t trees", &arg)) ntrees = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoull(arg);
+  if (Options::get("m model", &arg)) model = arg;
+  if (Options::get("p polytomy", &arg)) polytomy = std::stod(arg);
+  if (Options::get("x missing", &arg)) missing = std::stod(arg);
+  if (Options::get("c scale", &arg)) scale = std::stod(arg);
+  if (Options::get("L labels", &arg)) prefix = arg;
+  if (Options::get("o output", &arg)) output = arg;
+  if (Options::get("S species", &arg)) species_output = arg;
+  bool lengths = Options::get("l lengths");
+  if (model != "yule" && model != "caterpillar" && model != "coalescent") {
+    std::cerr << "unknown model " << model << std::endl;
+    return 1;
+  }
+
+  TaxonSet ts(ntaxa);
+  for (int i = 0; i < ntaxa; i++) {
+    ts.add(prefix + std::to_string(i));
+  }
+  TreeGenerator gen(ts, seed);
+
+  std::string buf;
+  SimTree species;
+  if (model == "coalescent") {
+    species = gen.yule();
+    if (species_output.size()) {
+      std::ofstream out(species_output);
+      gen.write_newick(species, buf, true);
+      buf += '\n';
+      flush(buf, out);
+    }
+  }
+
+  std::ofstream file;
+  if (output.size()) file.open(output);
+  std::ostream &out = output.size() ? file : std::cout;
+  for (int i = 0; i < ntrees; i++) {
+    SimTree tree = model == "yule"          ? gen.yule()
+                   : model == "caterpillar" ? gen.caterpillar()
+                                            : gen.coalescent(species, scale);
+    if (missing > 0) gen.drop_taxa(tree, missing);
+    if (polytomy > 0) gen.collapse(tree, polytomy);
+    gen.write_newick(tree, buf, lengths);
+    buf += '\n';
+    if (buf.size() >= flush_bytes) flush(buf, out);
+  }
+  flush(buf, out);
+  return 0;
+}
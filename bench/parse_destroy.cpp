@@ -0,0 +1,89 @@
+// Parse-then-destroy throughput for gene trees, with clade bitsets on the
+// heap and in a CladeArena.
+//
+//   parse_destroy -i genetrees.tre        trees of a newick file
+//   parse_destroy -n 1000 -t 10000 -s 7   random trees instead
+//
+// Each tree is parsed into a Tree and into a set of clades, and both are
+// destroyed before the next tree is parsed. The arena runs give each tree its
+// own arena, which is destroyed with the tree.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/CladeArena.hpp"
+#include "phylokit/newick.hpp"
+#include "phylokit/util/Options.hpp"
+
+namespace {
+
+template <class F>
+double time_trees(const std::vector<std::string> &trees, F parse) {
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string &tree : trees) {
+    parse(tree);
+  }
+  return seconds_since(start);
+}
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string input, arg;
+  int ntaxa = 1000, ntrees = 10000, seed = 1;
+  Options::get("i input", &input);
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("t trees", &arg)) ntrees = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoi(arg);
+
+  TaxonSet ts = taxon_set(taxon_names(ntaxa));
+  std::vector<std::string> trees;
+  if (input.size()) {
+    std::ifstream in(input);
+    std::string line;
+    std::unordered_set<std::string> names;
+    while (std::getline(in, line)) {
+      if (line.find('(') == std::string::npos) continue;
+      trees.push_back(line);
+      newick_to_ts(line, names);
+    }
+    ts = taxon_set(std::vector<std::string>(names.begin(), names.end()));
+  } else {
+    trees = yule_trees(ts, ntrees, seed);
+  }
+
+  double heap_tree = time_trees(trees, [&](const std::string &s) {
+    Tree tree = newick_to_treeclades(s, ts);
+  });
+  double arena_tree = time_trees(trees, [&](const std::string &s) {
+    CladeArena arena;
+    Tree tree = newick_to_treeclades(s, ts, &arena);
+  });
+  double heap_set = time_trees(trees, [&](const std::string &s) {
+    std::unordered_set<Clade> clades;
+    newick_to_clades(s, ts, clades);
+  });
+  double arena_set = time_trees(trees, [&](const std::string &s) {
+    CladeArena arena;
+    std::unordered_set<Clade> clades;
+    newick_to_clades(s, ts, clades, &arena);
+  });
+
+  std::cout << "parse\tstorage\ttrees\ttaxa\tseconds\ttrees_per_s" << std::endl;
+  auto row = [&](const char *parse, const char *storage, double seconds) {
+    std::cout << parse << "\t" << storage << "\t" << trees.size() << "\t"
+              << ts.size() << "\t" << seconds << "\t" << trees.size() / seconds
+              << std::endl;
+  };
+  row("treeclades", "heap", heap_tree);
+  row("treeclades", "arena", arena_tree);
+  row("clades", "heap", heap_set);
+  row("clades", "arena", arena_set);
+  return 0;
+}
@@ -0,0 +1,51 @@
+// Parses two balanced trees over a large taxon set and compares them, to see
+// how clade storage scales with the number of taxa.
+//
+//   sparse_clades -n 100000 -s 7
+//
+// Prints the time to parse each tree and to compute their RF distance, and
+// the peak resident set size of the process.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/TreeClade.hpp"
+#include "phylokit/newick.hpp"
+#include "phylokit/util/Options.hpp"
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string arg;
+  int ntaxa = 100000, seed = 1;
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoi(arg);
+
+  std::vector<std::string> names = taxon_names(ntaxa);
+  TaxonSet ts = taxon_set(names);
+
+  std::mt19937 rng(seed);
+  std::shuffle(names.begin(), names.end(), rng);
+  std::string first = balanced_tree(names);
+  std::shuffle(names.begin(), names.end(), rng);
+  std::string second = balanced_tree(names);
+
+  auto start = std::chrono::steady_clock::now();
+  Tree a = newick_to_treeclades(first, ts);
+  double parse_a = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  Tree b = newick_to_treeclades(second, ts);
+  double parse_b = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  double rf = a.RFDist(b);
+  double rf_time = seconds_since(start);
+
+  std::cout << "taxa\tparse_s\tparse2_s\trf\trf_s\tpeak_rss_kb" << std::endl;
+  std::cout << ntaxa << "\t" << parse_a << "\t" << parse_b << "\t" << rf
+            << "\t" << rf_time << "\t" << peak_rss_kb() << std::endl;
+  return 0;
+}
@@ -0,0 +1,388 @@
+// The benchmark suite for the core data structures, on synthetic inputs that
+// depend only on the options, so runs of different releases are comparable.
+//
+//   suite -n 1000 -t 100 -s 1 -m 0.2 -f parse -o results.json
+//
+//   -n  taxa of the trees (default 1000)
+//   -t  trees per run of the tree benchmarks (default 100)
+//   -s  seed of the inputs (default 1)
+//   -m  least seconds to spend on each case (default 0.2)
+//   -f  only run cases whose name contains this
+//   -o  write the JSON report here instead of to stdout
+//
+// Progress goes to stderr. Each case in the report has its input size, the
+// seconds and items (operations, trees, ...) per run, items per second and
+// the peak resident set size while it ran.
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/CladeInterner.hpp"
+#include "phylokit/CladeSet.hpp"
+#include "phylokit/DistanceMatrix.hpp"
+#include "phylokit/Quartet.hpp"
+#include "phylokit/TreeClade.hpp"
+#include "phylokit/newick.hpp"
+#include "phylokit/util/Options.hpp"
+
+namespace {
+
+// Results are added here so the compiler cannot drop the work.
+volatile size_t sink;
+
+// Bit vector operations per run.
+const int bit_ops = 1000;
+// QuartetDict takes space in the fourth power of its taxa.
+const int quartet_taxa = 32;
+
+BitVectorFixed random_bits(size_t size, size_t members, std::mt19937 &rng) {
+  BitVectorFixed bits(size);
+  for (size_t i = 0; i < members; i++) {
+    bits.set(uniform(rng, size));
+  }
+  return bits;
+}
+
+void bitvector_benchmarks(Harness &h, std::mt19937 &rng) {
+  for (size_t size : {64, 256, 1024, 16384, 100000}) {
+    // Half full, and over wide sets also a sparse pair of 16 members each.
+    for (size_t members : {size / 2, (size_t) 16}) {
+      if (members == 16 && size < BitVectorFixed::sparse_min_bits) {
+        continue;
+      }
+      std::string kind = members == 16 ? "sparse_" : "";
+      BitVectorFixed a = random_bits(size, members, rng);
+      BitVectorFixed b = random_bits(size, members, rng);
+      h.run("bitvector/" + kind + "and", size, [&]() {
+        for (int i = 0; i < bit_ops; i++) sink += (a & b).popcount();
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "or_assign", size, [&]() {
+        BitVectorFixed c(a);
+        for (int i = 0; i < bit_ops; i++) c |= b;
+        sink += c.popcount();
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "xor", size, [&]() {
+        for (int i = 0; i < bit_ops; i++) sink += (a ^ b).popcount();
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "popcount", size, [&]() {
+        for (int i = 0; i < bit_ops; i++) sink += a.popcount();
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "overlap_size", size, [&]() {
+        for (int i = 0; i < bit_ops; i++) sink += a.overlap_size(b);
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "is_subset_of", size, [&]() {
+        for (int i = 0; i < bit_ops; i++) sink += a.is_subset_of(a | b);
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "equal", size, [&]() {
+        BitVectorFixed c(a);
+        for (int i = 0; i < bit_ops; i++) sink += a == c;
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "copy_hash", size, [&]() {
+        for (int i = 0; i < bit_ops; i++) {
+          BitVectorFixed c(a);
+          c.set(0);
+          sink += c.hash();
+        }
+        return bit_ops;
+      });
+      h.run("bitvector/" + kind + "iterate", size, [&]() {
+        size_t n = 0;
+        for (int i = 0; i < bit_ops; i++) {
+          for (int t : a) n += t;
+        }
+        sink += n;
+        return bit_ops;
+      });
+    }
+  }
+}
+
+void clade_benchmarks(Harness &h, TaxonSet &ts,
+                      const std::vector<std::string> &trees) {
+  std::vector<Clade> clades;
+  std::unordered_set<Clade> set;
+  newick_to_clades(trees[0], ts, set);
+  clades.assign(set.begin(), set.end());
+  size_t n = ts.size(), pairs = clades.size() - 1;
+
+  h.run("clade/overlap", n, [&]() {
+    for (size_t i = 0; i < pairs; i++) {
+      sink += clades[i].overlap(clades[i + 1]).size();
+    }
+    return pairs;
+  });
+  h.run("clade/union", n, [&]() {
+    for (size_t i = 0; i < pairs; i++) {
+      Clade c(clades[i]);
+      c += clades[i + 1];
+      sink += c.size();
+    }
+    return pairs;
+  });
+  h.run("clade/difference", n, [&]() {
+    for (size_t i = 0; i < pairs; i++) {
+      sink += (clades[i] - clades[i + 1]).size();
+    }
+    return pairs;
+  });
+  h.run("clade/complement", n, [&]() {
+    for (size_t i = 0; i < pairs; i++) {
+      sink += clades[i].complement().size();
+    }
+    return pairs;
+  });
+  h.run("clade/relation", n, [&]() {
+    for (size_t i = 0; i < pairs; i++) {
+      sink += clades[i].relation(clades[i + 1]);
+    }
+    return pairs;
+  });
+  h.run("clade/compatible", n, [&]() {
+    for (size_t i = 0; i < pairs; i++) {
+      sink += clades[i].compatible(clades[i + 1]);
+    }
+    return pairs;
+  });
+}
+
+void taxonset_benchmarks(Harness &h, const std::vector<std::string> &names) {
+  h.run("taxonset/add", names.size(), [&]() {
+    TaxonSet ts(names.size());
+    for (const std::string &name : names) {
+      sink += ts.add(name);
+    }
+    return names.size();
+  });
+  h.run("taxonset/add_concurrent", names.size(), [&]() {
+    TaxonSet ts(names.size());
+    ts.make_concurrent();
+    for (const std::string &name : names) {
+      sink += ts.add(name);
+    }
+    ts.canonicalize();
+    return names.size();
+  });
+  TaxonSet ts(names.size());
+  for (const std::string &name : names) {
+    ts.add(name);
+  }
+  h.run("taxonset/lookup", names.size(), [&]() {
+    for (const std::string &name : names) {
+      sink += ts[name];
+    }
+    return names.size();
+  });
+  ts.freeze();
+  h.run("taxonset/lookup_frozen", names.size(), [&]() {
+    for (const std::string &name : names) {
+      sink += ts[name];
+    }
+    return names.size();
+  });
+}
+
+void parser_benchmarks(Harness &h, TaxonSet &ts,
+                       const std::vector<std::string> &trees) {
+  size_t n = ts.size();
+  h.run("parse/newick_to_ts", n, [&]() {
+    std::unordered_set<std::string> names;
+    for (const std::string &tree : trees) sink += newick_to_ts(tree, names);
+    return trees.size();
+  });
+  h.run("parse/newick_to_taxa", n, [&]() {
+    for (const std::string &tree : trees) {
+      sink += newick_to_taxa(tree, ts).size();
+    }
+    return trees.size();
+  });
+  h.run("parse/newick_to_clades", n, [&]() {
+    std::unordered_set<Clade> clades;
+    for (const std::string &tree : trees) newick_to_clades(tree, ts, clades);
+    sink += clades.size();
+    return trees.size();
+  });
+  h.run("parse/newick_to_clades_arena", n, [&]() {
+    CladeArena arena;
+    std::unordered_set<Clade> clades;
+    for (const std::string &tree : trees) {
+      newick_to_clades(tree, ts, clades, &arena);
+    }
+    sink += clades.size();
+    return trees.size();
+  });
+  h.run("parse/newick_to_clades_cladeset", n, [&]() {
+    CladeSet clades(ts);
+    for (const std::string &tree : trees) newick_to_clades(tree, ts, clades);
+    clades.build();
+    sink += clades.size();
+    return trees.size();
+  });
+  h.run("parse/newick_to_clades_interner", n, [&]() {
+    CladeInterner interner(ts);
+    std::vector<uint32_t> ids;
+    for (const std::string &tree : trees) {
+      newick_to_clades(tree, ts, interner, ids);
+    }
+    sink += interner.size();
+    return trees.size();
+  });
+  h.run("parse/newick_to_splits", n, [&]() {
+    std::unordered_set<Split> splits;
+    for (const std::string &tree : trees) newick_to_splits(tree, ts, splits);
+    sink += splits.size();
+    return trees.size();
+  });
+  h.run("parse/newick_to_treeclades", n, [&]() {
+    for (const std::string &tree : trees) {
+      sink += newick_to_treeclades(tree, ts).size();
+    }
+    return trees.size();
+  });
+  h.run("parse/newick_to_treeclades_clades", n, [&]() {
+    for (const std::string &tree : trees) {
+      sink += newick_to_treeclades(tree, ts).root().size();
+    }
+    return trees.size();
+  });
+  h.run("parse/newick_to_postorder", n, [&]() {
+    std::vector<Taxon> order;
+    for (const std::string &tree : trees) {
+      order.clear();
+      newick_to_postorder(tree, ts, order);
+      sink += order.size();
+    }
+    return trees.size();
+  });
+}
+
+void tree_benchmarks(Harness &h, TaxonSet &ts,
+                     const std::vector<std::string> &trees) {
+  size_t n = ts.size();
+  h.run("distance/accumulate", n, [&]() {
+    DistanceMatrix total(ts);
+    for (const std::string &tree : trees) {
+      total += DistanceMatrix(ts, tree);
+    }
+    sink += total(0, 1);
+    return trees.size();
+  });
+  DistanceMatrix total(ts);
+  for (const std::string &tree : trees) {
+    total += DistanceMatrix(ts, tree);
+  }
+  h.run("distance/upgma", n, [&]() {
+    // upgma marks the pairs it merges in the matrix, so use a fresh copy.
+    DistanceMatrix dm(total);
+    sink += dm.upgma().size();
+    return (size_t) 1;
+  });
+
+  // The distances read the clades, which are computed here rather than in
+  // the first timed run; parse/newick_to_treeclades_clades times them.
+  std::vector<Tree> parsed;
+  for (const std::string &tree : trees) {
+    parsed.push_back(newick_to_treeclades(tree, ts));
+    parsed.back().root();
+  }
+  h.run("tree/rfdist", n, [&]() {
+    double rf = 0;
+    for (size_t i = 0; i + 1 < parsed.size(); i++) {
+      rf += parsed[i].RFDist(parsed[i + 1]);
+    }
+    sink += rf;
+    return parsed.size() - 1;
+  });
+  h.run("tree/rfdist_unrooted", n, [&]() {
+    double rf = 0;
+    for (size_t i = 0; i + 1 < parsed.size(); i++) {
+      rf += parsed[i].RFDist(parsed[i + 1], true, true);
+    }
+    sink += rf;
+    return parsed.size() - 1;
+  });
+  h.run("tree/lca", n, [&]() {
+    DistanceMatrix lca(ts);
+    parsed[0].LCA(lca);
+    sink += lca(0, 1);
+    return (size_t) 1;
+  });
+}
+
+void quartet_benchmarks(Harness &h, std::mt19937 &rng) {
+  std::vector<std::string> names = taxon_names(quartet_taxa);
+  std::string path = "/tmp/phylokit_bench_quartets.txt";
+  size_t quartets = 0;
+  {
+    std::ofstream out(path);
+    for (int a = 0; a < quartet_taxa; a++)
+      for (int b = a + 1; b < quartet_taxa; b++)
+        for (int c = b + 1; c < quartet_taxa; c++)
+          for (int d = c + 1; d < quartet_taxa; d++) {
+            out << "((" << names[a] << "," << names[b] << "),(" << names[c]
+                << "," << names[d] << ")):" << uniform(rng, 100) << "\n";
+            quartets++;
+          }
+  }
+  TaxonSet ts = taxon_set(names);
+  h.run("quartet/load", quartet_taxa, [&]() {
+    QuartetDict qd(ts, path);
+    sink += qd(0, 1, 2, 3);
+    return quartets;
+  });
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string arg, filter, output;
+  int ntaxa = 1000, ntrees = 100, seed = 1;
+  double min_seconds = 0.2;
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("t trees", &arg)) ntrees = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoi(arg);
+  if (Options::get("m min_seconds", &arg)) min_seconds = std::stod(arg);
+  Options::get("f filter", &filter);
+  Options::get("o output", &output);
+
+  Harness h(min_seconds, filter);
+  h.config("taxa", ntaxa);
+  h.config("trees", ntrees);
+  h.config("seed", seed);
+  h.config("min_seconds", min_seconds);
+
+  std::mt19937 rng(seed);
+  std::vector<std::string> names = taxon_names(ntaxa);
+  TaxonSet ts = taxon_set(names);
+  std::vector<std::string> trees = yule_trees(ts, ntrees, seed);
+
+  bitvector_benchmarks(h, rng);
+  clade_benchmarks(h, ts, trees);
+  taxonset_benchmarks(h, names);
+  parser_benchmarks(h, ts, trees);
+  tree_benchmarks(h, ts, trees);
+  quartet_benchmarks(h, rng);
+
+  if (output.size()) {
+    std::ofstream out(output);
+    h.write_json(out);
+  } else {
+    h.write_json(std::cout);
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+// Per-taxon occupancy counts over the clades of random trees, counted member
+// by member through the clades' iterators and with a TaxonCounter.
+//
+//   taxon_counts -n 1000 -t 1000 -s 7
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench/Harness.hpp"
+#include "phylokit/TaxonCounter.hpp"
+#include "phylokit/newick.hpp"
+#include "phylokit/util/Options.hpp"
+
+int main(int argc, const char **argv) {
+  Options::init(argc, argv);
+  std::string arg;
+  int ntaxa = 1000, ntrees = 1000, seed = 1;
+  if (Options::get("n taxa", &arg)) ntaxa = std::stoi(arg);
+  if (Options::get("t trees", &arg)) ntrees = std::stoi(arg);
+  if (Options::get("s seed", &arg)) seed = std::stoi(arg);
+
+  TaxonSet ts = taxon_set(taxon_names(ntaxa));
+  std::vector<Clade> clades;
+  for (const std::string &tree : yule_trees(ts, ntrees, seed)) {
+    std::unordered_set<Clade> tree_clades;
+    newick_to_clades(tree, ts, tree_clades);
+    clades.insert(clades.end(), tree_clades.begin(), tree_clades.end());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<uint32_t> naive(ts.size(), 0);
+  for (const Clade &c : clades) {
+    for (Taxon t : c) {
+      naive[t]++;
+    }
+  }
+  double naive_s = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  TaxonCounter counter(ts);
+  for (const Clade &c : clades) {
+    counter.add(c);
+  }
+  std::vector<uint32_t> sliced = counter.counts();
+  double sliced_s = seconds_since(start);
+
+  if (naive != sliced) {
+    std::cerr << "counts disagree" << std::endl;
+    return 1;
+  }
+  std::cout << "method\tclades\ttaxa\tseconds" << std::endl;
+  std::cout << "iterator\t" << clades.size() << "\t" << ts.size() << "\t"
+            << naive_s << std::endl;
+  std::cout << "bit_sliced\t" << clades.size() << "\t" << ts.size() << "\t"
+            << sliced_s << std::endl;
+  return 0;
+}
@@ -0,0 +1,267 @@
+#ifndef BITEXPR_HPP__
+#define BITEXPR_HPP__
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "BitVector.hpp"
+
+// Lazy set algebra over BitVectorFixed (and Clade, see Clade.hpp). lazy(a)
+// wraps an operand without copying it, and &, |, ^, - and ~ on wrapped
+// operands build an expression whose words are computed on demand, so
+//
+//   int n = ((lazy(a) - b) | c).popcount();
+//   dst = lazy(root) - clade;
+//
+// make one pass over the words and build no temporary bit vectors. Plain
+// operands mix with expressions; at least one side of each operator has to
+// be an expression for the lazy operators to apply. An expression refers to
+// its operands, so evaluate it within the statement that builds it.
+//
+// Operands are read word by word in increasing order. Sparse operands are
+// decoded on the fly, so a lazy expression costs O(words) whatever the
+// forms of its operands; bit vectors of different widths read as zero past
+// their own words.
+
+// The base of every expression E, which provides size(), nwords(), start()
+// and word(i). The reducers consume an expression without storing its words.
+template <class E>
+struct BitExpr {
+  const E &self() const { return static_cast<const E &>(*this); }
+
+  int popcount() const {
+    const E &e = self();
+    e.start();
+    int ans = 0;
+    for (size_t i = 0; i < e.nwords(); i++) {
+      ans += popcount_word(e.word(i));
+    }
+    return ans;
+  }
+
+  // Whether any bit is set; stops at the first non-zero word.
+  bool any() const {
+    const E &e = self();
+    e.start();
+    for (size_t i = 0; i < e.nwords(); i++) {
+      if (e.word(i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // BitVectorFixed::hash of the result.
+  size_t hash() const {
+    const E &e = self();
+    e.start();
+    uint64_t h = hash_seed;
+    for (size_t i = 0; i < e.nwords(); i++) {
+      h ^= word_hash(i, e.word(i));
+    }
+    return h;
+  }
+};
+
+class BitLeaf : public BitExpr<BitLeaf> {
+ public:
+  explicit BitLeaf(const BitVectorFixed &bits)
+      : size_(bits.size), nwords_(bits.cap), data(bits.data),
+        members(bits.members), end(bits.members + bits.count),
+        next(bits.members) {}
+
+  size_t size() const { return size_; }
+  size_t nwords() const { return nwords_; }
+  void start() const { next = members; }
+  elem_type word(size_t i) const {
+    if (data) {
+      return i < nwords_ ? data[i] : 0;
+    }
+    return sparse_word(i);
+  }
+
+ private:
+  // Word i of a sparse operand. Skips the members below the word, which
+  // requires the words to be asked for in increasing order after start().
+  elem_type sparse_word(size_t i) const {
+    const size_t bits = 8 * sizeof(elem_type);
+    while (next != end && *next < i * bits) {
+      next++;
+    }
+    elem_type w = 0;
+    for (const uint32_t *p = next; p != end && *p < (i + 1) * bits; p++) {
+      w |= (elem_type) 1 << (*p % bits);
+    }
+    return w;
+  }
+
+  size_t size_;
+  size_t nwords_;
+  const elem_type *data;
+  const uint32_t *members;
+  const uint32_t *end;
+  mutable const uint32_t *next;
+};
+
+template <class Op, class L, class R>
+class BitBinary : public BitExpr<BitBinary<Op, L, R>> {
+ public:
+  BitBinary(const L &l, const R &r) : l(l), r(r) {}
+
+  size_t size() const { return std::max(l.size(), r.size()); }
+  size_t nwords() const { return std::max(l.nwords(), r.nwords()); }
+  void start() const {
+    l.start();
+    r.start();
+  }
+  elem_type word(size_t i) const { return Op::apply(l.word(i), r.word(i)); }
+
+ private:
+  L l;
+  R r;
+};
+
+// The complement within the operand's size; unlike BitVectorFixed's ~, the
+// bits past the size stay clear.
+template <class E>
+class BitNot : public BitExpr<BitNot<E>> {
+ public:
+  explicit BitNot(const E &e) : e(e) {}
+
+  size_t size() const { return e.size(); }
+  size_t nwords() const { return e.nwords(); }
+  void start() const { e.start(); }
+  elem_type word(size_t i) const {
+    const size_t bits = 8 * sizeof(elem_type);
+    size_t n = e.size();
+    elem_type mask = (i + 1) * bits <= n ? ~(elem_type) 0
+                     : i * bits < n      ? ~(elem_type) 0 >> (bits - n % bits)
+                                         : 0;
+    return ~e.word(i) & mask;
+  }
+
+ private:
+  E e;
+};
+
+struct AndWords {
+  static elem_type apply(elem_type a, elem_type b) { return a & b; }
+};
+struct OrWords {
+  static elem_type apply(elem_type a, elem_type b) { return a | b; }
+};
+struct XorWords {
+  static elem_type apply(elem_type a, elem_type b) { return a ^ b; }
+};
+struct AndNotWords {
+  static elem_type apply(elem_type a, elem_type b) { return a & ~b; }
+};
+
+inline BitLeaf lazy(const BitVectorFixed &bits) { return BitLeaf(bits); }
+
+// The expression for an operand: itself, or a leaf for a plain bit vector.
+// Clade.hpp adds the overload for clades.
+template <class E>
+const E &to_bit_expr(const BitExpr<E> &e) {
+  return e.self();
+}
+inline BitLeaf to_bit_expr(const BitVectorFixed &bits) {
+  return BitLeaf(bits);
+}
+
+template <class T>
+struct is_bit_expr : std::is_base_of<BitExpr<T>, T> {};
+
+// The expression type for an operand of type T.
+template <class T>
+struct bit_expr_type {
+  typedef typename std::decay<decltype(to_bit_expr(std::declval<T>()))>::type
+      type;
+};
+
+// Has a type only when either operand is an expression, leaving operators
+// between plain bit vectors and clades, or anything else, to their classes.
+template <class Op, class L, class R,
+          bool = is_bit_expr<L>::value || is_bit_expr<R>::value>
+struct lazy_binary {};
+template <class Op, class L, class R>
+struct lazy_binary<Op, L, R, true> {
+  typedef BitBinary<Op, typename bit_expr_type<L>::type,
+                    typename bit_expr_type<R>::type>
+      type;
+};
+
+template <class L, class R>
+typename lazy_binary<AndWords, L, R>::type operator&(const L &l, const R &r) {
+  return typename lazy_binary<AndWords, L, R>::type(to_bit_expr(l),
+                                                    to_bit_expr(r));
+}
+
+template <class L, class R>
+typename lazy_binary<OrWords, L, R>::type operator|(const L &l, const R &r) {
+  return typename lazy_binary<OrWords, L, R>::type(to_bit_expr(l),
+                                                   to_bit_expr(r));
+}
+
+template <class L, class R>
+typename lazy_binary<XorWords, L, R>::type operator^(const L &l, const R &r) {
+  return typename lazy_binary<XorWords, L, R>::type(to_bit_expr(l),
+                                                    to_bit_expr(r));
+}
+
+// Set difference, l & ~r.
+template <class L, class R>
+typename lazy_binary<AndNotWords, L, R>::type operator-(const L &l,
+                                                        const R &r) {
+  return typename lazy_binary<AndNotWords, L, R>::type(to_bit_expr(l),
+                                                       to_bit_expr(r));
+}
+
+template <class E>
+BitNot<E> operator~(const BitExpr<E> &e) {
+  return BitNot<E>(e.self());
+}
+
+// Whether two expressions hold the same bits, whatever their widths.
+template <class L, class R>
+typename std::enable_if<is_bit_expr<L>::value || is_bit_expr<R>::value,
+                        bool>::type
+operator==(const L &l, const R &r) {
+  return !(to_bit_expr(l) ^ to_bit_expr(r)).any();
+}
+
+template <class L, class R>
+typename std::enable_if<is_bit_expr<L>::value || is_bit_expr<R>::value,
+                        bool>::type
+operator!=(const L &l, const R &r) {
+  return !(l == r);
+}
+
+template <class E>
+BitVectorFixed &BitVectorFixed::operator=(const BitExpr<E> &expr) {
+  const E &e = expr.self();
+  e.start();
+  if (!is_sparse()) {
+    // Each word is read before it is written, so this bit vector may also
+    // be an operand.
+    elem_type *words = modify();
+    for (size_t i = 0; i < cap; i++) {
+      words[i] = e.word(i);
+    }
+    return *this;
+  }
+  // Gathers the members first, then picks the form for their number.
+  static thread_local std::vector<uint32_t> buf;
+  buf.clear();
+  const size_t bits = 8 * sizeof(elem_type);
+  for (size_t i = 0; i < cap; i++) {
+    for (elem_type w = e.word(i); w; w &= w - 1) {
+      buf.push_back(i * bits + lowest_bit(w));
+    }
+  }
+  assign_members(buf.data(), buf.size());
+  return *this;
+}
+
+#endif  // BITEXPR_HPP__
@@ -0,0 +1,223 @@
+#include "BitMatrix.hpp"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "BitSimd.hpp"
+
+namespace {
+
+const size_t line_words = 64 / sizeof(elem_type);
+
+// Allocates n words starting on a cache line; the words are owned by raw.
+elem_type *aligned_words(size_t n, std::unique_ptr<elem_type[]> &raw) {
+  raw.reset(new elem_type[n + line_words - 1]);
+  uintptr_t p = reinterpret_cast<uintptr_t>(raw.get());
+  p = (p + 63) & ~(uintptr_t) 63;
+  elem_type *words = reinterpret_cast<elem_type *>(p);
+  memset(words, 0, n * sizeof(elem_type));
+  return words;
+}
+
+template <size_t W>
+struct RowPopcounts {
+  static void run(const elem_type *rows, size_t nrows, int *out,
+                  size_t stride) {
+    for (size_t r = 0; r < nrows; r++) {
+      out[r] = BitWords<W>::popcount(rows + r * stride, stride);
+    }
+  }
+};
+template <size_t W>
+struct RowOverlaps {
+  static void run(const elem_type *rows, size_t nrows, const elem_type *q,
+                  int *out, size_t stride) {
+    for (size_t r = 0; r < nrows; r++) {
+      out[r] = BitWords<W>::overlap_size(rows + r * stride, q, stride);
+    }
+  }
+};
+template <size_t W>
+struct RowRelations {
+  static void run(const elem_type *rows, size_t nrows, const elem_type *q,
+                  SetRelation *out, size_t stride) {
+    for (size_t r = 0; r < nrows; r++) {
+      out[r] = BitWords<W>::relation(rows + r * stride, q, stride);
+    }
+  }
+};
+
+template <size_t W>
+struct RowAnds {
+  static void run(elem_type *rows, size_t nrows, const elem_type *q,
+                  size_t stride) {
+    for (size_t r = 0; r < nrows; r++) {
+      BitWords<W>::and_(rows + r * stride, rows + r * stride, q, stride);
+    }
+  }
+};
+
+// Wide rows go through the SIMD kernels picked for this CPU.
+template <>
+struct RowPopcounts<0> {
+  static void run(const elem_type *rows, size_t nrows, int *out,
+                  size_t stride) {
+    const BitSimdKernels &simd = bit_simd();
+    for (size_t r = 0; r < nrows; r++) {
+      out[r] = simd.popcount(rows + r * stride, stride);
+    }
+  }
+};
+template <>
+struct RowOverlaps<0> {
+  static void run(const elem_type *rows, size_t nrows, const elem_type *q,
+                  int *out, size_t stride) {
+    const BitSimdKernels &simd = bit_simd();
+    for (size_t r = 0; r < nrows; r++) {
+      out[r] = simd.overlap_size(rows + r * stride, q, stride);
+    }
+  }
+};
+
+// The query's words, padded to the stride of the matrix.
+struct Query {
+  std::unique_ptr<elem_type[]> raw;
+  elem_type *words;
+  Query(const Clade &query, size_t stride)
+      : words(aligned_words(stride, raw)) {
+    query.get_taxa().copy_words(words);
+  }
+};
+
+}  // namespace
+
+BitMatrix::BitMatrix(const TaxonSet &ts)
+    : ts_(&ts), nrows(0), capacity(0), data(NULL) {
+  size_t words = (ts.size() + 8 * sizeof(elem_type) - 1) /
+                 (8 * sizeof(elem_type));
+  stride_ = std::max(line_words, (words + line_words - 1) / line_words *
+                                     line_words);
+}
+
+BitMatrix::BitMatrix(const TaxonSet &ts,
+                     const std::unordered_set<Clade> &clades)
+    : BitMatrix(ts) {
+  reserve(clades.size());
+  for (const Clade &c : clades) {
+    add(c);
+  }
+}
+
+BitMatrix::BitMatrix(const Tree &tree) : BitMatrix(tree.ts) {
+  reserve(tree.size());
+  for (int i = 0; i < tree.size(); i++) {
+    add(tree.node(i));
+  }
+}
+
+void BitMatrix::reserve(size_t rows) {
+  if (rows <= capacity) {
+    return;
+  }
+  std::unique_ptr<elem_type[]> raw;
+  elem_type *words = aligned_words(rows * stride_, raw);
+  if (nrows) {
+    memcpy(words, data, nrows * stride_ * sizeof(elem_type));
+  }
+  storage = std::move(raw);
+  data = words;
+  capacity = rows;
+}
+
+size_t BitMatrix::add(const Clade &clade) {
+  if (nrows == capacity) {
+    reserve(std::max<size_t>(16, 2 * capacity));
+  }
+  clade.get_taxa().copy_words(data + nrows * stride_);
+  return nrows++;
+}
+
+Clade BitMatrix::row(size_t r) const {
+  Clade c(*ts_);
+  const elem_type *words = row_words(r);
+  for (size_t i = 0; i < stride_; i++) {
+    for (elem_type w = words[i]; w; w &= w - 1) {
+      c.add(i * 8 * sizeof(elem_type) + lowest_bit(w));
+    }
+  }
+  return c;
+}
+
+bool BitMatrix::get(size_t r, Taxon t) const {
+  return (row_words(r)[t / (8 * sizeof(elem_type))] >>
+          (t % (8 * sizeof(elem_type)))) & 1;
+}
+
+std::vector<int> BitMatrix::popcounts() const {
+  std::vector<int> out(nrows);
+  dispatch_words<RowPopcounts>(stride_, data, nrows, out.data());
+  return out;
+}
+
+std::vector<int> BitMatrix::overlap_sizes(const Clade &query) const {
+  Query q(query, stride_);
+  std::vector<int> out(nrows);
+  dispatch_words<RowOverlaps>(stride_, data, nrows,
+                              (const elem_type *) q.words, out.data());
+  return out;
+}
+
+std::vector<SetRelation> BitMatrix::relations(const Clade &query) const {
+  Query q(query, stride_);
+  std::vector<SetRelation> out(nrows);
+  dispatch_words<RowRelations>(stride_, data, nrows,
+                               (const elem_type *) q.words, out.data());
+  return out;
+}
+
+template <class Pred>
+clade_bitset BitMatrix::select_rows(const Clade &query, Pred pred) const {
+  std::vector<SetRelation> rel = relations(query);
+  clade_bitset out(nrows);
+  for (size_t r = 0; r < nrows; r++) {
+    if (pred(rel[r])) {
+      out.set(r);
+    }
+  }
+  return out;
+}
+
+clade_bitset BitMatrix::subsets_of(const Clade &query) const {
+  return select_rows(query, [](SetRelation r) {
+    return r == SUBSET || r == EQUAL;
+  });
+}
+
+clade_bitset BitMatrix::supersets_of(const Clade &query) const {
+  return select_rows(query, [](SetRelation r) {
+    return r == SUPERSET || r == EQUAL;
+  });
+}
+
+clade_bitset BitMatrix::compatible_with(const Clade &query) const {
+  return select_rows(query, [](SetRelation r) { return r != CROSSING; });
+}
+
+clade_bitset BitMatrix::column(Taxon t) const {
+  clade_bitset out(nrows);
+  const elem_type *words = data + t / (8 * sizeof(elem_type));
+  int bit = t % (8 * sizeof(elem_type));
+  for (size_t r = 0; r < nrows; r++, words += stride_) {
+    if ((*words >> bit) & 1) {
+      out.set(r);
+    }
+  }
+  return out;
+}
+
+void BitMatrix::intersect(const Clade &query) {
+  Query q(query, stride_);
+  dispatch_words<RowAnds>(stride_, data, nrows, (const elem_type *) q.words);
+}
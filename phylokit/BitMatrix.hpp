@@ -0,0 +1,69 @@
+#ifndef BITMATRIX_HPP__
+#define BITMATRIX_HPP__
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "BitWords.hpp"
+#include "Clade.hpp"
+#include "CladeView.hpp"
+#include "TreeClade.hpp"
+
+// A batch of clades over one taxon set, stored as the rows of one contiguous
+// matrix. Rows start on 64-byte cache lines and are padded to a multiple of
+// eight words, so the batch kernels stream through the matrix with the same
+// word kernels as single bit vectors instead of chasing one heap block per
+// clade. Questions about every row at once, such as which clades contain a
+// taxon or are compatible with a query, are answered as a bit vector over the
+// rows.
+class BitMatrix {
+ public:
+  explicit BitMatrix(const TaxonSet &ts);
+  BitMatrix(const TaxonSet &ts, const std::unordered_set<Clade> &clades);
+  // Row i holds the clade of node i.
+  explicit BitMatrix(const Tree &tree);
+
+  // Appends clade as a new row and returns its index.
+  size_t add(const Clade &clade);
+
+  const TaxonSet &ts() const { return *ts_; }
+  size_t rows() const { return nrows; }
+  // Words per row.
+  size_t stride() const { return stride_; }
+  const elem_type *row_words(size_t r) const { return data + r * stride_; }
+  Clade row(size_t r) const;
+  // Row r without copying it; valid until the next add.
+  CladeView view(size_t r) const { return CladeView(row_words(r), stride_); }
+  bool get(size_t r, Taxon t) const;
+
+  std::vector<int> popcounts() const;
+  std::vector<int> overlap_sizes(const Clade &query) const;
+  // How each row relates to query.
+  std::vector<SetRelation> relations(const Clade &query) const;
+  // The rows that are subsets of query, that contain it, and that are
+  // compatible with it.
+  clade_bitset subsets_of(const Clade &query) const;
+  clade_bitset supersets_of(const Clade &query) const;
+  clade_bitset compatible_with(const Clade &query) const;
+  // The rows containing taxon t.
+  clade_bitset column(Taxon t) const;
+
+  // Replaces every row with its overlap with query.
+  void intersect(const Clade &query);
+
+ private:
+  void reserve(size_t rows);
+  template <class Pred>
+  clade_bitset select_rows(const Clade &query, Pred pred) const;
+
+  const TaxonSet *ts_;
+  size_t nrows;
+  size_t capacity;
+  size_t stride_;
+  // data is storage rounded up to a cache line.
+  std::unique_ptr<elem_type[]> storage;
+  elem_type *data;
+};
+
+#endif  // BITMATRIX_HPP__
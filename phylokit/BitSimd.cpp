@@ -0,0 +1,344 @@
+#include "BitSimd.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BITSIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+int popcount_scalar(const elem_type *a, size_t n) {
+  return BitWords<0>::popcount(a, n);
+}
+int overlap_size_scalar(const elem_type *a, const elem_type *b, size_t n) {
+  return BitWords<0>::overlap_size(a, b, n);
+}
+bool equal_scalar(const elem_type *a, const elem_type *b, size_t n) {
+  return !memcmp(a, b, n * sizeof(elem_type));
+}
+void and_scalar(elem_type *out, const elem_type *a, const elem_type *b,
+                size_t n) {
+  BitWords<0>::and_(out, a, b, n);
+}
+void or_scalar(elem_type *out, const elem_type *a, const elem_type *b,
+               size_t n) {
+  BitWords<0>::or_(out, a, b, n);
+}
+void xor_scalar(elem_type *out, const elem_type *a, const elem_type *b,
+                size_t n) {
+  BitWords<0>::xor_(out, a, b, n);
+}
+
+const BitSimdKernels scalar_kernels = {
+    "scalar",  popcount_scalar, overlap_size_scalar, equal_scalar,
+    and_scalar, or_scalar,      xor_scalar};
+
+#ifdef BITSIMD_X86
+
+// Scalar loops compiled for the hardware popcnt instruction, for CPUs that
+// have it but no AVX2.
+
+__attribute__((target("popcnt"))) int popcount_popcnt(const elem_type *a,
+                                                      size_t n) {
+  return BitWords<0>::popcount(a, n);
+}
+__attribute__((target("popcnt"))) int overlap_size_popcnt(const elem_type *a,
+                                                          const elem_type *b,
+                                                          size_t n) {
+  return BitWords<0>::overlap_size(a, b, n);
+}
+
+const BitSimdKernels popcnt_kernels = {
+    "popcnt",   popcount_popcnt, overlap_size_popcnt, equal_scalar,
+    and_scalar, or_scalar,       xor_scalar};
+
+// AVX2: Harley-Seal carry-save popcount over 256-bit lanes, counting the
+// final bytes with the pshufb nibble lookup (Mula, Kurz and Lemire).
+
+const size_t avx2_words = 4;
+
+__attribute__((target("avx2"))) inline __m256i popcount256(__m256i v) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, low_mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) inline void csa256(__m256i &h, __m256i &l,
+                                                   __m256i a, __m256i b,
+                                                   __m256i c) {
+  __m256i u = _mm256_xor_si256(a, b);
+  h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  l = _mm256_xor_si256(u, c);
+}
+
+template <bool Intersect>
+__attribute__((target("avx2"))) inline __m256i load256(const elem_type *a,
+                                                      const elem_type *b,
+                                                      size_t i) {
+  __m256i v = _mm256_loadu_si256((const __m256i *) (a + i * avx2_words));
+  if (Intersect) {
+    v = _mm256_and_si256(
+        v, _mm256_loadu_si256((const __m256i *) (b + i * avx2_words)));
+  }
+  return v;
+}
+
+template <bool Intersect>
+__attribute__((target("avx2"))) int harley_seal_avx2(const elem_type *a,
+                                                     const elem_type *b,
+                                                     size_t n) {
+  size_t vectors = n / avx2_words;
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256();
+  __m256i twos = _mm256_setzero_si256();
+  __m256i fours = _mm256_setzero_si256();
+  __m256i eights = _mm256_setzero_si256();
+  __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+
+  size_t i = 0;
+  for (; i + 16 <= vectors; i += 16) {
+    csa256(twos_a, ones, ones, load256<Intersect>(a, b, i),
+           load256<Intersect>(a, b, i + 1));
+    csa256(twos_b, ones, ones, load256<Intersect>(a, b, i + 2),
+           load256<Intersect>(a, b, i + 3));
+    csa256(fours_a, twos, twos, twos_a, twos_b);
+    csa256(twos_a, ones, ones, load256<Intersect>(a, b, i + 4),
+           load256<Intersect>(a, b, i + 5));
+    csa256(twos_b, ones, ones, load256<Intersect>(a, b, i + 6),
+           load256<Intersect>(a, b, i + 7));
+    csa256(fours_b, twos, twos, twos_a, twos_b);
+    csa256(eights_a, fours, fours, fours_a, fours_b);
+    csa256(twos_a, ones, ones, load256<Intersect>(a, b, i + 8),
+           load256<Intersect>(a, b, i + 9));
+    csa256(twos_b, ones, ones, load256<Intersect>(a, b, i + 10),
+           load256<Intersect>(a, b, i + 11));
+    csa256(fours_a, twos, twos, twos_a, twos_b);
+    csa256(twos_a, ones, ones, load256<Intersect>(a, b, i + 12),
+           load256<Intersect>(a, b, i + 13));
+    csa256(twos_b, ones, ones, load256<Intersect>(a, b, i + 14),
+           load256<Intersect>(a, b, i + 15));
+    csa256(fours_b, twos, twos, twos_a, twos_b);
+    csa256(eights_b, fours, fours, fours_a, fours_b);
+    csa256(sixteens, eights, eights, eights_a, eights_b);
+    total = _mm256_add_epi64(total, popcount256(sixteens));
+  }
+
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+  total = _mm256_add_epi64(total, popcount256(ones));
+  for (; i < vectors; i++) {
+    total = _mm256_add_epi64(total, popcount256(load256<Intersect>(a, b, i)));
+  }
+
+  int ans = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+            _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+  for (size_t w = vectors * avx2_words; w < n; w++) {
+    ans += popcount_word(Intersect ? a[w] & b[w] : a[w]);
+  }
+  return ans;
+}
+
+__attribute__((target("avx2"))) int popcount_avx2(const elem_type *a,
+                                                  size_t n) {
+  return harley_seal_avx2<false>(a, a, n);
+}
+
+__attribute__((target("avx2"))) int overlap_size_avx2(const elem_type *a,
+                                                      const elem_type *b,
+                                                      size_t n) {
+  return harley_seal_avx2<true>(a, b, n);
+}
+
+__attribute__((target("avx2"))) bool equal_avx2(const elem_type *a,
+                                                const elem_type *b, size_t n) {
+  size_t i = 0;
+  for (; i + avx2_words <= n; i += avx2_words) {
+    __m256i va = _mm256_loadu_si256((const __m256i *) (a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *) (b + i));
+    __m256i diff = _mm256_xor_si256(va, vb);
+    if (!_mm256_testz_si256(diff, diff)) {
+      return false;
+    }
+  }
+  for (; i < n; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#define BITSIMD_AVX2_BINARY(NAME, INTRINSIC, OP)                           \
+  __attribute__((target("avx2"))) void NAME(                               \
+      elem_type *out, const elem_type *a, const elem_type *b, size_t n) {  \
+    size_t i = 0;                                                          \
+    for (; i + avx2_words <= n; i += avx2_words) {                         \
+      _mm256_storeu_si256(                                                 \
+          (__m256i *) (out + i),                                           \
+          INTRINSIC(_mm256_loadu_si256((const __m256i *) (a + i)),         \
+                    _mm256_loadu_si256((const __m256i *) (b + i))));       \
+    }                                                                      \
+    for (; i < n; i++) {                                                   \
+      out[i] = a[i] OP b[i];                                               \
+    }                                                                      \
+  }
+
+BITSIMD_AVX2_BINARY(and_avx2, _mm256_and_si256, &)
+BITSIMD_AVX2_BINARY(or_avx2, _mm256_or_si256, |)
+BITSIMD_AVX2_BINARY(xor_avx2, _mm256_xor_si256, ^)
+
+const BitSimdKernels avx2_kernels = {
+    "avx2",   popcount_avx2, overlap_size_avx2, equal_avx2,
+    and_avx2, or_avx2,       xor_avx2};
+
+// AVX-512: native 64-bit lane popcount (VPOPCNTDQ), with masked loads for
+// the tail so no scalar cleanup loop is needed.
+
+#define BITSIMD_AVX512 "avx512f,avx512vpopcntdq"
+
+const size_t avx512_words = 8;
+
+__attribute__((target(BITSIMD_AVX512))) inline __mmask8 tail_mask(size_t n) {
+  return (__mmask8)((1u << n) - 1);
+}
+
+// The sum of the lanes, added up from memory once per call. GCC 12's
+// _mm512_reduce_add_epi64 and the 256-bit extracts it is built from trip
+// -Wuninitialized inside their own headers.
+__attribute__((target(BITSIMD_AVX512))) inline int reduce_add512(__m512i v) {
+  uint64_t lanes[avx512_words];
+  _mm512_storeu_si512(lanes, v);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < avx512_words; i++) {
+    sum += lanes[i];
+  }
+  return sum;
+}
+
+__attribute__((target(BITSIMD_AVX512))) int popcount_avx512(const elem_type *a,
+                                                           size_t n) {
+  __m512i total = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + avx512_words <= n; i += avx512_words) {
+    __m512i v = _mm512_loadu_si512(a + i);
+    total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+  }
+  if (i < n) {
+    __m512i v = _mm512_maskz_loadu_epi64(tail_mask(n - i), a + i);
+    total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+  }
+  return reduce_add512(total);
+}
+
+__attribute__((target(BITSIMD_AVX512))) int overlap_size_avx512(
+    const elem_type *a, const elem_type *b, size_t n) {
+  __m512i total = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + avx512_words <= n; i += avx512_words) {
+    __m512i v = _mm512_and_si512(_mm512_loadu_si512(a + i),
+                                 _mm512_loadu_si512(b + i));
+    total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+  }
+  if (i < n) {
+    __mmask8 m = tail_mask(n - i);
+    __m512i v = _mm512_and_si512(_mm512_maskz_loadu_epi64(m, a + i),
+                                 _mm512_maskz_loadu_epi64(m, b + i));
+    total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+  }
+  return reduce_add512(total);
+}
+
+__attribute__((target(BITSIMD_AVX512))) bool equal_avx512(const elem_type *a,
+                                                         const elem_type *b,
+                                                         size_t n) {
+  size_t i = 0;
+  for (; i + avx512_words <= n; i += avx512_words) {
+    if (_mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a + i),
+                                 _mm512_loadu_si512(b + i))) {
+      return false;
+    }
+  }
+  if (i < n) {
+    __mmask8 m = tail_mask(n - i);
+    return !_mm512_mask_cmpneq_epi64_mask(m, _mm512_maskz_loadu_epi64(m, a + i),
+                                          _mm512_maskz_loadu_epi64(m, b + i));
+  }
+  return true;
+}
+
+#define BITSIMD_AVX512_BINARY(NAME, INTRINSIC)                             \
+  __attribute__((target(BITSIMD_AVX512))) void NAME(                       \
+      elem_type *out, const elem_type *a, const elem_type *b, size_t n) {  \
+    size_t i = 0;                                                          \
+    for (; i + avx512_words <= n; i += avx512_words) {                     \
+      _mm512_storeu_si512(out + i, INTRINSIC(_mm512_loadu_si512(a + i),    \
+                                             _mm512_loadu_si512(b + i)));  \
+    }                                                                      \
+    if (i < n) {                                                           \
+      __mmask8 m = tail_mask(n - i);                                       \
+      _mm512_mask_storeu_epi64(                                            \
+          out + i, m,                                                      \
+          INTRINSIC(_mm512_maskz_loadu_epi64(m, a + i),                    \
+                    _mm512_maskz_loadu_epi64(m, b + i)));                  \
+    }                                                                      \
+  }
+
+BITSIMD_AVX512_BINARY(and_avx512, _mm512_and_si512)
+BITSIMD_AVX512_BINARY(or_avx512, _mm512_or_si512)
+BITSIMD_AVX512_BINARY(xor_avx512, _mm512_xor_si512)
+
+const BitSimdKernels avx512_kernels = {
+    "avx512",   popcount_avx512, overlap_size_avx512, equal_avx512,
+    and_avx512, or_avx512,       xor_avx512};
+
+#endif  // BITSIMD_X86
+
+const BitSimdKernels &select_bit_simd() {
+  std::vector<const BitSimdKernels *> supported = supported_bit_simd_kernels();
+  const char *requested = getenv("PHYLOKIT_BITSIMD");
+  if (requested) {
+    for (const BitSimdKernels *k : supported) {
+      if (std::string(k->name) == requested) {
+        return *k;
+      }
+    }
+  }
+  return *supported.back();
+}
+
+}  // namespace
+
+std::vector<const BitSimdKernels *> supported_bit_simd_kernels() {
+  std::vector<const BitSimdKernels *> kernels;
+  kernels.push_back(&scalar_kernels);
+#ifdef BITSIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("popcnt")) {
+    kernels.push_back(&popcnt_kernels);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(&avx2_kernels);
+  }
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512vpopcntdq")) {
+    kernels.push_back(&avx512_kernels);
+  }
+#endif
+  return kernels;
+}
+
+const BitSimdKernels &bit_simd() {
+  static const BitSimdKernels &kernels = select_bit_simd();
+  return kernels;
+}
@@ -0,0 +1,163 @@
+#ifndef BITSIMD_HPP__
+#define BITSIMD_HPP__
+
+#include <string>
+#include <vector>
+
+#include "BitWords.hpp"
+
+// Bulk word kernels for bit vectors too wide for a BitWords<W>
+// instantiation. One implementation is picked from CPUID the first time it
+// is needed, so a single binary uses AVX-512 VPOPCNTDQ or AVX2 where the
+// host supports it and scalar loops elsewhere. Setting the PHYLOKIT_BITSIMD
+// environment variable to "scalar", "popcnt", "avx2" or "avx512"
+// overrides the choice (an unsupported request falls back to the default).
+struct BitSimdKernels {
+  const char *name;
+  int (*popcount)(const elem_type *a, size_t n);
+  int (*overlap_size)(const elem_type *a, const elem_type *b, size_t n);
+  bool (*equal)(const elem_type *a, const elem_type *b, size_t n);
+  void (*and_)(elem_type *out, const elem_type *a, const elem_type *b,
+               size_t n);
+  void (*or_)(elem_type *out, const elem_type *a, const elem_type *b,
+              size_t n);
+  void (*xor_)(elem_type *out, const elem_type *a, const elem_type *b,
+               size_t n);
+};
+
+const BitSimdKernels &bit_simd();
+
+std::vector<const BitSimdKernels *> supported_bit_simd_kernels();
+
+// Kernel<W> wrappers over BitWords<W> for dispatch_words, shared by
+// BitVectorFixed and CladeView.
+namespace word_kernels {
+
+template <size_t W>
+struct Popcount {
+  static int run(const elem_type *a, size_t n) {
+    return BitWords<W>::popcount(a, n);
+  }
+};
+template <size_t W>
+struct OverlapSize {
+  static int run(const elem_type *a, const elem_type *b, size_t n) {
+    return BitWords<W>::overlap_size(a, b, n);
+  }
+};
+template <size_t W>
+struct Equal {
+  static bool run(const elem_type *a, const elem_type *b, size_t n) {
+    return BitWords<W>::equal(a, b, n);
+  }
+};
+template <size_t W>
+struct Hash {
+  static uint64_t run(const elem_type *a, size_t n) {
+    return BitWords<W>::hash(a, n);
+  }
+};
+template <size_t W>
+struct IsSubset {
+  static bool run(const elem_type *a, const elem_type *b, size_t n) {
+    return BitWords<W>::is_subset(a, b, n);
+  }
+};
+template <size_t W>
+struct Intersects {
+  static bool run(const elem_type *a, const elem_type *b, size_t n) {
+    return BitWords<W>::intersects(a, b, n);
+  }
+};
+template <size_t W>
+struct AndNotCount {
+  static int run(const elem_type *a, const elem_type *b, size_t n) {
+    return BitWords<W>::and_not_count(a, b, n);
+  }
+};
+template <size_t W>
+struct Relation {
+  static SetRelation run(const elem_type *a, const elem_type *b, size_t n) {
+    return BitWords<W>::relation(a, b, n);
+  }
+};
+template <size_t W>
+struct And {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    BitWords<W>::and_(out, a, b, n);
+  }
+};
+template <size_t W>
+struct Or {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    BitWords<W>::or_(out, a, b, n);
+  }
+};
+template <size_t W>
+struct AndNot {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    BitWords<W>::and_not(out, a, b, n);
+  }
+};
+template <size_t W>
+struct Xor {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    BitWords<W>::xor_(out, a, b, n);
+  }
+};
+template <size_t W>
+struct Not {
+  static void run(elem_type *out, const elem_type *a, size_t n) {
+    BitWords<W>::not_(out, a, n);
+  }
+};
+
+// Bit vectors wider than max_fixed_words go through the SIMD kernels picked
+// for this CPU.
+template <>
+struct Popcount<0> {
+  static int run(const elem_type *a, size_t n) {
+    return bit_simd().popcount(a, n);
+  }
+};
+template <>
+struct OverlapSize<0> {
+  static int run(const elem_type *a, const elem_type *b, size_t n) {
+    return bit_simd().overlap_size(a, b, n);
+  }
+};
+template <>
+struct Equal<0> {
+  static bool run(const elem_type *a, const elem_type *b, size_t n) {
+    return bit_simd().equal(a, b, n);
+  }
+};
+template <>
+struct And<0> {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    bit_simd().and_(out, a, b, n);
+  }
+};
+template <>
+struct Or<0> {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    bit_simd().or_(out, a, b, n);
+  }
+};
+template <>
+struct Xor<0> {
+  static void run(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    bit_simd().xor_(out, a, b, n);
+  }
+};
+
+}  // namespace word_kernels
+
+#endif  // BITSIMD_HPP__
@@ -1,84 +1,425 @@
 #include "BitVector.hpp"
+#include "BitSimd.hpp"
+#include "CladeArena.hpp"
+#include "SparseBits.hpp"
+#include <algorithm>
 #include <functional>
 #include <string.h>
 #include <sstream>
 #include <bitset>
 #include <cassert>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #ifdef _WIN32
 #include <intrin.h>
 
 #endif
 
+namespace {
+// Walks the non-zero words of a bit vector, from either form, in order.
+class NonzeroWords {
+  const elem_type *data;
+  size_t i, n;
+  const uint32_t *members, *end;
+
+ public:
+  NonzeroWords(const elem_type *data, size_t n, const uint32_t *members,
+               size_t count)
+      : data(data), i(0), n(n), members(members), end(members + count) {}
+  bool next(size_t &index, elem_type &w) {
+    const size_t bits = 8 * sizeof(elem_type);
+    if (data) {
+      while (i < n && !data[i]) {
+        i++;
+      }
+      if (i == n) {
+        return false;
+      }
+      index = i;
+      w = data[i++];
+      return true;
+    }
+    if (members == end) {
+      return false;
+    }
+    index = *members / bits;
+    w = 0;
+    for (; members != end && *members / bits == index; members++) {
+      w |= (elem_type) 1 << (*members % bits);
+    }
+    return true;
+  }
+};
+
+}  // namespace
+
 // BitVectorFixed::BitVectorFixed() :
 //   size(0),
 //   cap(0),
 //   data(NULL) {
 // }
 
-BitVectorFixed::BitVectorFixed(size_t size) :
+BitVectorFixed::BitVectorFixed(size_t size, CladeArena *arena) :
     size(size),
-    cap(1 + size / (8 * sizeof(elem_type))) {
-  data = new elem_type[cap];
-  memset(data, 0, cap * sizeof(elem_type));
-  assert(data);
-  assert(data[0] == 0);
+    data(NULL),
+    members(NULL),
+    arena(arena),
+    cap(words_for(size)),
+    count(0),
+    member_cap(0),
+    hash_(hash_seed) {
+  init();
 }
 BitVectorFixed::BitVectorFixed(const BitVectorFixed &other) :
     size(other.size),
+    data(NULL),
+    members(NULL),
+    arena(NULL),
+    cap(other.cap),
+    count(0),
+    member_cap(0),
+    hash_(other.cached_hash()) {
+  copy_from(other);
+}
+
+BitVectorFixed::BitVectorFixed(const BitVectorFixed &other,
+                               CladeArena *arena) :
+    size(other.size),
+    data(NULL),
+    members(NULL),
+    arena(arena),
+    cap(other.cap),
+    count(0),
+    member_cap(0),
+    hash_(other.cached_hash()) {
+  copy_from(other);
+}
+
+BitVectorFixed::BitVectorFixed(BitVectorFixed &&other) noexcept :
+    size(other.size),
+    data(NULL),
+    members(NULL),
+    arena(NULL),
     cap(other.cap) {
-  data = new elem_type[cap];
-  memcpy(data, other.data, sizeof(elem_type) * cap);
-  assert(data);
+  take(other);
 }
 
-void BitVectorFixed::resize(size_t sz) {
-  size = sz;
-  cap = (1 + size / (8 * sizeof(elem_type)));
-  if (data)
+size_t BitVectorFixed::words_for(size_t size) {
+  size_t words = (size + 8 * sizeof(elem_type) - 1) / (8 * sizeof(elem_type));
+  return fixed_words_for(words);
+}
+
+void BitVectorFixed::init() {
+  if (size >= sparse_min_bits) {
+    allocate_members(0);
+  } else {
+    allocate();
+    memset(data, 0, cap * sizeof(elem_type));
+  }
+  assert(data || members);
+}
+
+elem_type *BitVectorFixed::new_words(size_t n) {
+  return arena ? arena->allocate_words(n) : new elem_type[n];
+}
+
+uint32_t *BitVectorFixed::new_members(size_t n) {
+  return arena ? arena->allocate_members(n) : new uint32_t[n];
+}
+
+void BitVectorFixed::allocate() {
+  if (cap <= inline_words) {
+    data = inline_data;
+  } else {
+    data = new_words(cap);
+  }
+}
+
+void BitVectorFixed::allocate_members(size_t n) {
+  count = 0;
+  if (n <= 2 * inline_words) {
+    member_cap = 2 * inline_words;
+    members = inline_members;
+  } else {
+    member_cap = n;
+    members = new_members(n);
+  }
+}
+
+// Copies other's contents into this bit vector, whose own storage must
+// already be released.
+void BitVectorFixed::copy_from(const BitVectorFixed &other) {
+  if (other.is_sparse()) {
+    allocate_members(other.count);
+    count = other.count;
+    memcpy(members, other.members, sizeof(uint32_t) * count);
+  } else {
+    allocate();
+    memcpy(data, other.data, sizeof(elem_type) * cap);
+  }
+}
+
+void BitVectorFixed::release() {
+  if (!is_inline() && !arena) {
     delete[] data;
-  data = new elem_type[cap];
+    delete[] members;
+  }
+  data = NULL;
+  members = NULL;
+}
+
+// Moves other's storage into this bit vector, whose own storage must already
+// be released. Heap storage changes owner; inline storage is copied. other is
+// left as an empty bit vector.
+void BitVectorFixed::take(BitVectorFixed &other) {
+  arena = other.arena;
+  size = other.size;
+  cap = other.cap;
+  count = other.count;
+  member_cap = other.member_cap;
+  set_hash(other.cached_hash());
+  data = NULL;
+  members = NULL;
+  if (other.data == other.inline_data) {
+    data = inline_data;
+    memcpy(data, other.data, sizeof(elem_type) * cap);
+  } else if (other.members == other.inline_members) {
+    members = inline_members;
+    memcpy(members, other.members, sizeof(uint32_t) * count);
+  } else {
+    data = other.data;
+    members = other.members;
+  }
+  other.size = 0;
+  other.cap = 1;
+  other.count = 0;
+  other.member_cap = 0;
+  other.set_hash(hash_seed);
+  other.members = NULL;
+  other.data = other.inline_data;
+  other.inline_data[0] = 0;
+}
+
+// Switches a sparse bit vector to words. Sparse bit vectors are always wider
+// than the inline words, so the words go on the heap or in the arena.
+void BitVectorFixed::make_dense() {
+  assert(is_sparse() && cap > inline_words);
+  elem_type *words = new_words(cap);
+  memset(words, 0, cap * sizeof(elem_type));
+  for (size_t i = 0; i < count; i++) {
+    words[members[i] / (8 * sizeof(elem_type))] |=
+        (elem_type) 1 << members[i] % (8 * sizeof(elem_type));
+  }
+  release();
+  count = 0;
+  member_cap = 0;
+  data = words;
+}
+
+void BitVectorFixed::assign_members(const uint32_t *buf, size_t n) {
+  set_hash(0);
+  if (size >= sparse_min_bits && n <= cap) {
+    if (!is_sparse() || member_cap < n) {
+      release();
+      allocate_members(n);
+    }
+    memcpy(members, buf, sizeof(uint32_t) * n);
+    count = n;
+    return;
+  }
+  if (is_sparse()) {
+    release();
+    count = 0;
+    member_cap = 0;
+    allocate();
+  }
   memset(data, 0, cap * sizeof(elem_type));
-  assert(data);
+  for (size_t i = 0; i < n; i++) {
+    data[buf[i] / (8 * sizeof(elem_type))] |=
+        (elem_type) 1 << buf[i] % (8 * sizeof(elem_type));
+  }
+}
+
+void BitVectorFixed::resize(size_t sz) {
+  release();
+  size = sz;
+  cap = words_for(size);
+  count = 0;
+  member_cap = 0;
+  set_hash(hash_seed);
+  init();
 }
 
 BitVectorFixed &BitVectorFixed::operator=(const BitVectorFixed &other) {
   if (this == &other) {
     return *this;
   }
+  if (!is_sparse() && !other.is_sparse() && cap == other.cap) {
+    memcpy(data, other.data, sizeof(elem_type) * cap);
+  } else if (is_sparse() && other.is_sparse() && member_cap >= other.count) {
+    count = other.count;
+    memcpy(members, other.members, sizeof(uint32_t) * count);
+  } else {
+    release();
+    cap = other.cap;
+    copy_from(other);
+  }
   size = other.size;
   cap = other.cap;
-  if (data)
-    delete[] data;
-  data = new elem_type[cap];
-  memcpy(data, other.data, sizeof(elem_type) * cap);
+  set_hash(other.cached_hash());
+  return *this;
+}
+
+BitVectorFixed &BitVectorFixed::operator=(BitVectorFixed &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  release();
+  take(other);
   return *this;
 }
 
 BitVectorFixed::~BitVectorFixed() {
-  if (data)
-    delete[] data;
-  data = NULL;
+  release();
 }
 
 void BitVectorFixed::set(int i) {
   assert(cap > i / (8 * sizeof(elem_type)));
+  size_t w = i / (8 * sizeof(elem_type));
   elem_type val = ((elem_type) 1 << i % (8 * sizeof(elem_type)));
-  data[i / (8 * sizeof(elem_type))] |= val;
+  if (is_sparse()) {
+    // Parsers add taxa in increasing order, so try the end first.
+    uint32_t *pos = members + count;
+    if (count && members[count - 1] >= (uint32_t) i) {
+      pos = std::lower_bound(members, members + count, (uint32_t) i);
+      if (*pos == (uint32_t) i) {
+        return;
+      }
+    }
+    if (count < cap) {
+      if (size_t h = cached_hash()) {
+        elem_type old = word(w);
+        set_hash(h ^ word_hash(w, old) ^ word_hash(w, old | val));
+      }
+      size_t at = pos - members;
+      if (count == member_cap) {
+        uint32_t grown_cap = std::min<size_t>(2 * member_cap, cap);
+        uint32_t *grown = new_members(grown_cap);
+        memcpy(grown, members, sizeof(uint32_t) * count);
+        release();
+        members = grown;
+        member_cap = grown_cap;
+      }
+      memmove(members + at + 1, members + at, sizeof(uint32_t) * (count - at));
+      members[at] = i;
+      count++;
+      return;
+    }
+    make_dense();
+  }
+  size_t h = cached_hash();
+  if (h && !(data[w] & val)) {
+    set_hash(h ^ word_hash(w, data[w]) ^ word_hash(w, data[w] | val));
+  }
+  data[w] |= val;
 }
 
 void BitVectorFixed::unset(int i) {
   assert(cap > i / (8 * sizeof(elem_type)));
-  data[i / (8 * sizeof(elem_type))] &= ~((elem_type) 1 << i % (8 * sizeof(elem_type)));
+  size_t w = i / (8 * sizeof(elem_type));
+  elem_type val = ((elem_type) 1 << i % (8 * sizeof(elem_type)));
+  if (is_sparse()) {
+    uint32_t *pos = std::lower_bound(members, members + count, (uint32_t) i);
+    if (pos == members + count || *pos != (uint32_t) i) {
+      return;
+    }
+    if (size_t h = cached_hash()) {
+      elem_type old = word(w);
+      set_hash(h ^ word_hash(w, old) ^ word_hash(w, old & ~val));
+    }
+    memmove(pos, pos + 1, sizeof(uint32_t) * (members + count - pos - 1));
+    count--;
+    return;
+  }
+  size_t h = cached_hash();
+  if (h && (data[w] & val)) {
+    set_hash(h ^ word_hash(w, data[w]) ^ word_hash(w, data[w] & ~val));
+  }
+  data[w] &= ~val;
 }
 
 bool BitVectorFixed::get(int i) const {
   assert(cap > i / (8 * sizeof(elem_type)));
+  if (is_sparse()) {
+    return sorted_contains(members, count, i);
+  }
   return data[i / (8 * sizeof(elem_type))] & ((elem_type) 1 << i % (8 * sizeof(elem_type)));
 }
 
+elem_type BitVectorFixed::word(size_t i) const {
+  if (!is_sparse()) {
+    return data[i];
+  }
+  const size_t bits = 8 * sizeof(elem_type);
+  elem_type ans = 0;
+  for (const uint32_t *p = std::lower_bound(members, members + count, i * bits);
+       p != members + count && *p < (i + 1) * bits; p++) {
+    ans |= (elem_type) 1 << (*p % bits);
+  }
+  return ans;
+}
+
+void BitVectorFixed::copy_words(elem_type *out) const {
+  const size_t bits = 8 * sizeof(elem_type);
+  size_t n = (size + bits - 1) / bits;
+  if (!is_sparse()) {
+    memcpy(out, data, n * sizeof(elem_type));
+    return;
+  }
+  memset(out, 0, n * sizeof(elem_type));
+  for (size_t i = 0; i < count; i++) {
+    out[members[i] / bits] |= (elem_type) 1 << members[i] % bits;
+  }
+}
+
+void BitVectorFixed::assign_words(const elem_type *in) {
+  const size_t bits = 8 * sizeof(elem_type);
+  size_t n = (size + bits - 1) / bits;
+  if (!is_sparse()) {
+    elem_type *out = modify();
+    memcpy(out, in, n * sizeof(elem_type));
+    memset(out + n, 0, (cap - n) * sizeof(elem_type));
+    return;
+  }
+  static thread_local std::vector<uint32_t> buf;
+  buf.clear();
+  for (size_t w = 0; w < n; w++) {
+    for (elem_type rest = in[w]; rest; rest &= rest - 1) {
+      buf.push_back(w * bits + lowest_bit(rest));
+    }
+  }
+  assign_members(buf.data(), buf.size());
+}
+
+void BitVectorFixed::permute(const int *to, size_t n) {
+  static thread_local std::vector<uint32_t> buf;
+  buf.clear();
+  for (int i : *this) {
+    buf.push_back((size_t) i < n ? to[i] : i);
+  }
+  // Only the sparse form needs the members in order.
+  if (size >= sparse_min_bits && buf.size() <= cap) {
+    std::sort(buf.begin(), buf.end());
+  }
+  assign_members(buf.data(), buf.size());
+}
+
 int BitVectorFixed::ffs() const {
+  if (is_sparse()) {
+    return count ? members[0] : -1;
+  }
   size_t i;
   int ans = 0;
 #ifdef _WIN32
@@ -103,127 +444,350 @@ int BitVectorFixed::ffs() const {
 }
 
 int BitVectorFixed::popcount() const {
-  int ans = 0;
-  for (size_t i = 0; i < cap; i++) {
-#ifdef _WIN32
-    ans += __popcnt64	(data[i]);
-#else
-    ans += __builtin_popcountl(data[i]);
-#endif
+  if (is_sparse()) {
+    return count;
   }
-  return ans;
+  return dispatch_words<word_kernels::Popcount>(cap, data);
 }
 
 bool BitVectorFixed::operator==(const BitVectorFixed &other) const {
-  return (size == other.size) && !memcmp(data, other.data, sizeof(elem_type) * cap);
+  if (size != other.size) {
+    return false;
+  }
+  if (!is_sparse() && !other.is_sparse()) {
+    return dispatch_words<word_kernels::Equal>(cap, data, other.data);
+  }
+  if (is_sparse() && other.is_sparse()) {
+    return count == other.count &&
+           !memcmp(members, other.members, sizeof(uint32_t) * count);
+  }
+  int n = popcount();
+  return n == other.popcount() && overlap_size(other) == n;
 }
 
 bool BitVectorFixed::operator!=(const BitVectorFixed &other) const {
   return !(*this == other);
 }
 
+int BitVectorFixed::compare(const BitVectorFixed &other) const {
+  if (size != other.size) {
+    return size < other.size ? -1 : 1;
+  }
+  if (!is_sparse() && !other.is_sparse()) {
+    for (size_t i = 0; i < cap; i++) {
+      if (data[i] != other.data[i]) {
+        return data[i] < other.data[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+  // Where only one side has a non-zero word, that side is the larger.
+  NonzeroWords a(data, cap, members, count);
+  NonzeroWords b(other.data, other.cap, other.members, other.count);
+  size_t ia, ib;
+  elem_type wa, wb;
+  while (true) {
+    bool has_a = a.next(ia, wa), has_b = b.next(ib, wb);
+    if (!has_a || !has_b) {
+      return has_a - has_b;
+    }
+    if (ia != ib) {
+      return ia < ib ? 1 : -1;
+    }
+    if (wa != wb) {
+      return wa < wb ? -1 : 1;
+    }
+  }
+}
+
 size_t BitVectorFixed::hash() const {
-  size_t h = 0;
-  std::hash<elem_type> hasher;
-  for (size_t i = 0; i < cap; i++) {
-    h ^= hasher(data[i]);
+  size_t h = cached_hash();
+  if (h) {
+    return h;
+  }
+  if (!is_sparse()) {
+    h = dispatch_words<word_kernels::Hash>(cap, data);
+    set_hash(h);
+    return h;
+  }
+  // Rebuild each non-zero word from its run of members.
+  const size_t bits = 8 * sizeof(elem_type);
+  h = hash_seed;
+  for (size_t i = 0; i < count;) {
+    size_t w = members[i] / bits;
+    elem_type val = 0;
+    for (; i < count && members[i] / bits == w; i++) {
+      val |= (elem_type) 1 << (members[i] % bits);
+    }
+    h ^= word_hash(w, val);
   }
+  set_hash(h);
   return h;
 }
 
 BVFIterator BitVectorFixed::begin() const {
-  return BVFIterator(*this);
+  if (is_sparse()) {
+    return BVFIterator(members, count);
+  }
+  return BVFIterator(data, cap);
 }
 BVFIterator BitVectorFixed::end() const {
   return BVFIterator();
 }
 
 int BitVectorFixed::overlap_size(const BitVectorFixed &other) const {
-  int ol = 0;
-  for (size_t i = 0; i < cap; i++) {
-#ifdef _WIN32
-    ol += __popcnt64(data[i] & other.data[i]);
-#else
-    ol += __builtin_popcountl(data[i] & other.data[i]);
-#endif
+  if (!is_sparse() && !other.is_sparse()) {
+    return dispatch_words<word_kernels::OverlapSize>(cap, data, other.data);
+  }
+  if (is_sparse() && other.is_sparse()) {
+    return sorted_overlap_size(members, count, other.members, other.count);
+  }
+  if (is_sparse()) {
+    return sorted_words_overlap_size(members, count, other.data);
+  }
+  return sorted_words_overlap_size(other.members, other.count, data);
+}
 
+bool BitVectorFixed::is_subset_of(const BitVectorFixed &other) const {
+  if (!is_sparse() && !other.is_sparse()) {
+    return dispatch_words<word_kernels::IsSubset>(cap, data, other.data);
+  }
+  if (is_sparse() && other.is_sparse()) {
+    return sorted_is_subset(members, count, other.members, other.count);
+  }
+  if (is_sparse()) {
+    for (size_t i = 0; i < count; i++) {
+      if (!words_contain(other.data, members[i])) {
+        return false;
+      }
+    }
+    return true;
   }
-  return ol;
+  return popcount() <= other.popcount() && !and_not_count(other);
 }
 
-BitVectorFixed BitVectorFixed::operator~() const {
+bool BitVectorFixed::is_disjoint(const BitVectorFixed &other) const {
+  return !intersects(other);
+}
+
+bool BitVectorFixed::intersects(const BitVectorFixed &other) const {
+  if (!is_sparse() && !other.is_sparse()) {
+    return dispatch_words<word_kernels::Intersects>(cap, data, other.data);
+  }
+  return overlap_size(other) > 0;
+}
+
+int BitVectorFixed::and_not_count(const BitVectorFixed &other) const {
+  if (!is_sparse() && !other.is_sparse()) {
+    return dispatch_words<word_kernels::AndNotCount>(cap, data, other.data);
+  }
+  return popcount() - overlap_size(other);
+}
+
+SetRelation BitVectorFixed::relation(const BitVectorFixed &other) const {
+  if (!is_sparse() && !other.is_sparse()) {
+    return dispatch_words<word_kernels::Relation>(cap, data, other.data);
+  }
+  int both = overlap_size(other);
+  return relation_from_counts(both, popcount() - both,
+                              other.popcount() - both);
+}
+
+BitVectorFixed BitVectorFixed::operator~() const & {
+  if (is_sparse()) {
+    return ~BitVectorFixed(*this);
+  }
   BitVectorFixed output(size);
-  for (size_t i = 0; i < cap; i++) {
-    output.data[i] = ~data[i];
+  if (output.is_sparse()) {
+    output.make_dense();
   }
+  dispatch_words<word_kernels::Not>(cap, output.modify(), data);
   return output;
 }
 
-BitVectorFixed BitVectorFixed::operator&(const BitVectorFixed &other) const {
+BitVectorFixed BitVectorFixed::operator~() && {
+  if (is_sparse()) {
+    make_dense();
+  }
+  dispatch_words<word_kernels::Not>(cap, modify(), data);
+  return std::move(*this);
+}
+
+// Operators with a sparse operand copy whichever operand keeps the result
+// cheapest to build, then apply the compound assignment.
+
+BitVectorFixed BitVectorFixed::operator&(const BitVectorFixed &other) const & {
+  if (is_sparse() || other.is_sparse()) {
+    BitVectorFixed output(is_sparse() ? *this : other);
+    output &= is_sparse() ? other : *this;
+    return output;
+  }
   BitVectorFixed output(size);
-  for (size_t i = 0; i < cap; i++) {
-    output.data[i] = data[i] & other.data[i];
+  if (output.is_sparse()) {
+    output.make_dense();
   }
+  dispatch_words<word_kernels::And>(cap, output.modify(), data, other.data);
   return output;
 }
 
 BitVectorFixed &BitVectorFixed::operator&=(const BitVectorFixed &other) {
-  for (size_t i = 0; i < cap; i++) {
-    data[i] = data[i] & other.data[i];
+  if (!is_sparse() && !other.is_sparse()) {
+    dispatch_words<word_kernels::And>(cap, modify(), data, other.data);
+  } else if (is_sparse()) {
+    set_hash(0);
+    count = other.is_sparse()
+                ? sorted_filter(members, count, other.members, other.count, true)
+                : sorted_words_filter(members, count, other.data, true);
+  } else {
+    // Only other's members can survive, so filter a copy of them and keep
+    // this bit vector's storage, and with it its arena.
+    static thread_local std::vector<uint32_t> buf;
+    buf.assign(other.members, other.members + other.count);
+    size_t n = sorted_words_filter(buf.data(), buf.size(), data, true);
+    assign_members(buf.data(), n);
   }
   return *this;
 }
 
-BitVectorFixed BitVectorFixed::operator|(const BitVectorFixed &other) const {
+BitVectorFixed BitVectorFixed::operator&(const BitVectorFixed &other) && {
+  *this &= other;
+  return std::move(*this);
+}
+
+BitVectorFixed BitVectorFixed::operator|(const BitVectorFixed &other) const & {
+  if (is_sparse() || other.is_sparse()) {
+    BitVectorFixed output(other.is_sparse() ? *this : other);
+    output |= other.is_sparse() ? other : *this;
+    return output;
+  }
   BitVectorFixed output(size);
-  for (size_t i = 0; i < cap; i++) {
-    output.data[i] = data[i] | other.data[i];
+  if (output.is_sparse()) {
+    output.make_dense();
   }
+  dispatch_words<word_kernels::Or>(cap, output.modify(), data, other.data);
   return output;
 }
 
 BitVectorFixed &BitVectorFixed::operator|=(const BitVectorFixed &other) {
-  for (size_t i = 0; i < cap; i++) {
-    data[i] = data[i] | other.data[i];
+  if (!is_sparse() && !other.is_sparse()) {
+    dispatch_words<word_kernels::Or>(cap, modify(), data, other.data);
+  } else if (!is_sparse()) {
+    elem_type *words = modify();
+    for (size_t i = 0; i < other.count; i++) {
+      words[other.members[i] / (8 * sizeof(elem_type))] |=
+          (elem_type) 1 << other.members[i] % (8 * sizeof(elem_type));
+    }
+  } else if (!other.is_sparse()) {
+    make_dense();
+    dispatch_words<word_kernels::Or>(cap, modify(), data, other.data);
+  } else {
+    static thread_local std::vector<uint32_t> buf;
+    buf.resize(count + other.count);
+    size_t n = std::set_union(members, members + count, other.members,
+                              other.members + other.count, buf.begin()) -
+               buf.begin();
+    assign_members(buf.data(), n);
   }
   return *this;
 }
 
-BitVectorFixed BitVectorFixed::operator^(const BitVectorFixed &other) const {
+BitVectorFixed BitVectorFixed::operator|(const BitVectorFixed &other) && {
+  *this |= other;
+  return std::move(*this);
+}
+
+BitVectorFixed BitVectorFixed::operator^(const BitVectorFixed &other) const & {
+  if (is_sparse() || other.is_sparse()) {
+    BitVectorFixed output(other.is_sparse() ? *this : other);
+    output ^= other.is_sparse() ? other : *this;
+    return output;
+  }
   BitVectorFixed output(size);
-  for (size_t i = 0; i < cap; i++) {
-    output.data[i] = data[i] ^ other.data[i];
+  if (output.is_sparse()) {
+    output.make_dense();
   }
+  dispatch_words<word_kernels::Xor>(cap, output.modify(), data, other.data);
   return output;
 }
 
 BitVectorFixed &BitVectorFixed::operator^=(const BitVectorFixed &other) {
-  for (size_t i = 0; i < cap; i++) {
-    data[i] = data[i] ^ other.data[i];
+  if (!is_sparse() && !other.is_sparse()) {
+    dispatch_words<word_kernels::Xor>(cap, modify(), data, other.data);
+  } else if (!is_sparse()) {
+    elem_type *words = modify();
+    for (size_t i = 0; i < other.count; i++) {
+      words[other.members[i] / (8 * sizeof(elem_type))] ^=
+          (elem_type) 1 << other.members[i] % (8 * sizeof(elem_type));
+    }
+  } else if (!other.is_sparse()) {
+    make_dense();
+    dispatch_words<word_kernels::Xor>(cap, modify(), data, other.data);
+  } else {
+    static thread_local std::vector<uint32_t> buf;
+    buf.resize(count + other.count);
+    size_t n = std::set_symmetric_difference(members, members + count,
+                                             other.members,
+                                             other.members + other.count,
+                                             buf.begin()) -
+               buf.begin();
+    assign_members(buf.data(), n);
   }
   return *this;
 }
 
+BitVectorFixed BitVectorFixed::operator^(const BitVectorFixed &other) && {
+  *this ^= other;
+  return std::move(*this);
+}
+
+BitVectorFixed BitVectorFixed::operator-(const BitVectorFixed &other) const & {
+  if (is_sparse() || other.is_sparse()) {
+    BitVectorFixed output(*this);
+    output -= other;
+    return output;
+  }
+  BitVectorFixed output(size);
+  if (output.is_sparse()) {
+    output.make_dense();
+  }
+  dispatch_words<word_kernels::AndNot>(cap, output.modify(), data, other.data);
+  return output;
+}
+
+BitVectorFixed &BitVectorFixed::operator-=(const BitVectorFixed &other) {
+  if (!is_sparse() && !other.is_sparse()) {
+    dispatch_words<word_kernels::AndNot>(cap, modify(), data, other.data);
+  } else if (is_sparse()) {
+    set_hash(0);
+    count = other.is_sparse()
+                ? sorted_filter(members, count, other.members, other.count,
+                                false)
+                : sorted_words_filter(members, count, other.data, false);
+  } else {
+    elem_type *words = modify();
+    for (size_t i = 0; i < other.count; i++) {
+      words[other.members[i] / (8 * sizeof(elem_type))] &=
+          ~((elem_type) 1 << other.members[i] % (8 * sizeof(elem_type)));
+    }
+  }
+  return *this;
+}
+
+BitVectorFixed BitVectorFixed::operator-(const BitVectorFixed &other) && {
+  *this -= other;
+  return std::move(*this);
+}
+
 std::string BitVectorFixed::str() const {
   std::stringstream ss;
   for (int i = cap - 1; i >= 0; i--) {
-    ss << std::bitset<sizeof(data[i]) * 8>(data[i]);
+    ss << std::bitset<sizeof(elem_type) * 8>(word(i));
   }
   return ss.str();
 }
 
-void BVFIterator::increment() {
-  current = data.ffs();
-  if (current >= 0)
-    data.unset(current);
-}
-
 void BitVectorFixed::do_swap(BitVectorFixed &other) {
-  std::swap(size, other.size);
-  std::swap(cap, other.cap);
-  std::swap(data, other.data);
-  assert(data);
-  assert(other.data);
+  BitVectorFixed tmp(std::move(other));
+  other = std::move(*this);
+  *this = std::move(tmp);
 }
-
-
@@ -2,22 +2,51 @@
 #define BITVECTOR_HPP__
 
 #include <inttypes.h>
+#include <atomic>
 #include <cstdlib>
 #include <string>
 
-typedef uint64_t elem_type;
+#include "BitWords.hpp"
 
+class BitLeaf;
 class BVFIterator;
+class CladeArena;
+class RankSelect;
+template <class E>
+struct BitExpr;
 
 class BitVectorFixed {
 
  public:
+  // Bit vectors of up to inline_bits bits keep their words inside the object,
+  // so clades over typical gene tree taxon sets never touch the heap.
+  static const size_t inline_words = 4;
+  static const size_t inline_bits = inline_words * 8 * sizeof(elem_type);
+  // Bit vectors of at least sparse_min_bits bits hold small sets as a sorted
+  // array of member indices instead of words: a three-taxon clade over 100k
+  // taxa then takes a few bytes rather than 12.5 KB. A sparse bit vector
+  // switches to words once its array would outgrow half their size, and
+  // results computed from sparse operands go back to an array when they are
+  // small enough again. Both forms behave identically through this API.
+  static const size_t sparse_min_bits = 4096;
+
   size_t size;
 
-  BitVectorFixed(size_t size);
+  // With an arena, storage that does not fit inline comes from the arena,
+  // also when the bit vector grows later, and is never freed by the bit
+  // vector. Copies made without an arena use the heap again; moves take the
+  // arena along with the storage.
+  BitVectorFixed(size_t size, CladeArena *arena = NULL);
   BitVectorFixed(const BitVectorFixed &other);
+  BitVectorFixed(const BitVectorFixed &other, CladeArena *arena);
+  BitVectorFixed(BitVectorFixed &&other) noexcept;
   ~BitVectorFixed();
   BitVectorFixed &operator=(const BitVectorFixed &other);
+  BitVectorFixed &operator=(BitVectorFixed &&other) noexcept;
+  // Evaluates a lazy set expression of the same size (see BitExpr.hpp) in
+  // one pass. The bit vector may be one of the expression's operands.
+  template <class E>
+  BitVectorFixed &operator=(const BitExpr<E> &expr);
   void resize(size_t sz);
 
   void set(int i);
@@ -25,33 +54,114 @@ class BitVectorFixed {
   bool get(int i) const;
   int ffs() const;
   int popcount() const;
+  // Moves each bit i below n to bit to[i], where to is a permutation of
+  // 0 .. n - 1; the bits from n on stay put.
+  void permute(const int *to, size_t n);
+  // Word i of the dense form, also for sparse bit vectors.
+  elem_type word(size_t i) const;
+  // Writes the (size + 63) / 64 words of the dense form to out.
+  void copy_words(elem_type *out) const;
+  // Replaces the contents with the words copy_words() would write.
+  void assign_words(const elem_type *in);
+  // Cached; set() and unset() keep the cached value up to date, and bulk
+  // operations make the next call recompute it.
   size_t hash() const;
   int overlap_size(const BitVectorFixed &other) const;
 
+  // Set relations, computed without building temporary bit vectors and
+  // returning as soon as the answer is known.
+  bool is_subset_of(const BitVectorFixed &other) const;
+  bool is_disjoint(const BitVectorFixed &other) const;
+  bool intersects(const BitVectorFixed &other) const;
+  // Number of bits set here but not in other.
+  int and_not_count(const BitVectorFixed &other) const;
+  SetRelation relation(const BitVectorFixed &other) const;
+
   std::string str() const;
 
   BVFIterator begin() const;
   BVFIterator end() const;
 
   void do_swap(BitVectorFixed &other);
+  bool is_inline() const {
+    return data == inline_data || members == inline_members;
+  }
+  bool is_sparse() const { return members != NULL; }
 
   bool operator==(const BitVectorFixed &other) const;
   bool operator!=(const BitVectorFixed &other) const;
-  BitVectorFixed operator&(const BitVectorFixed &other) const;
+  // A total order consistent with ==: by size, then lexicographically by
+  // word from the lowest, each word compared as an unsigned integer.
+  // Returns a negative, zero or positive value like strcmp.
+  int compare(const BitVectorFixed &other) const;
+  bool operator<(const BitVectorFixed &other) const {
+    return compare(other) < 0;
+  }
+  // The rvalue overloads compute the result in the left operand's words, so
+  // chains like (a & b) | c allocate at most once.
+  BitVectorFixed operator&(const BitVectorFixed &other) const &;
+  BitVectorFixed operator&(const BitVectorFixed &other) &&;
   BitVectorFixed &operator&=(const BitVectorFixed &other);
-  BitVectorFixed operator|(const BitVectorFixed &other) const;
+  BitVectorFixed operator|(const BitVectorFixed &other) const &;
+  BitVectorFixed operator|(const BitVectorFixed &other) &&;
   BitVectorFixed &operator|=(const BitVectorFixed &other);
-  BitVectorFixed operator^(const BitVectorFixed &other) const;
+  BitVectorFixed operator^(const BitVectorFixed &other) const &;
+  BitVectorFixed operator^(const BitVectorFixed &other) &&;
   BitVectorFixed &operator^=(const BitVectorFixed &other);
-  BitVectorFixed operator~() const;
+  BitVectorFixed operator~() const &;
+  BitVectorFixed operator~() &&;
+  // Set difference, this & ~other.
+  BitVectorFixed operator-(const BitVectorFixed &other) const &;
+  BitVectorFixed operator-(const BitVectorFixed &other) &&;
+  BitVectorFixed &operator-=(const BitVectorFixed &other);
 
   friend void swap(BitVectorFixed &lhs, BitVectorFixed &rhs) {
     lhs.do_swap(rhs);
   }
+  friend class BitLeaf;
+  friend class RankSelect;
 
  private:
+  static size_t words_for(size_t size);
+  // Empty storage for size bits, sparse if the vector is wide enough.
+  void init();
+  void allocate();
+  void allocate_members(size_t n);
+  void copy_from(const BitVectorFixed &other);
+  elem_type *new_words(size_t n);
+  uint32_t *new_members(size_t n);
+  void release();
+  void take(BitVectorFixed &other);
+  void make_dense();
+  // Replaces the contents with the n sorted indices in buf, choosing the
+  // sparse form if they fit in it.
+  void assign_members(const uint32_t *buf, size_t n);
+  // The words, for an operation that overwrites them wholesale and so drops
+  // the cached hash.
+  elem_type *modify() {
+    set_hash(0);
+    return data;
+  }
+  size_t cached_hash() const { return hash_.load(std::memory_order_relaxed); }
+  void set_hash(size_t h) const { hash_.store(h, std::memory_order_relaxed); }
+
+  // Exactly one of data and members is set.
   elem_type *data;
+  uint32_t *members;
+  CladeArena *arena;
+  // Words of the dense form, which is also the most members the sparse form
+  // holds before switching to words.
   size_t cap;
+  uint32_t count;
+  uint32_t member_cap;
+  // Hash of the current words, or 0 if it has to be recomputed. Atomic so
+  // that threads may hash a shared const bit vector: they all store the
+  // same value.
+  mutable std::atomic<size_t> hash_;
+  union {
+    elem_type inline_data[inline_words];
+    uint32_t inline_members[2 * inline_words];
+  };
 
 };
 
@@ -64,31 +174,60 @@ struct hash<BitVectorFixed> {
 };
 }
 
+// Iterates over the set bits of a BitVectorFixed without copying it. The
+// iterator keeps the word holding the current bit with the bits already
+// visited cleared, so a full pass costs O(words + popcount); over a sparse
+// bit vector it walks the member array instead. The bit vector must outlive
+// the iterator and not change while it is in use.
 class BVFIterator {
-  BitVectorFixed data;
+  const elem_type *data;
+  const uint32_t *members;
+  // Words, or members when iterating a sparse bit vector.
   size_t cap;
+  size_t word;
+  elem_type rest;
   int current;
  public:
-  BVFIterator() : data(1), current(-1) {}
-  BVFIterator(const BitVectorFixed &data) : data(data) {
-
+  BVFIterator()
+      : data(NULL), members(NULL), cap(0), word(0), rest(0), current(-1) {}
+  BVFIterator(const elem_type *data, size_t cap)
+      : data(data), members(NULL), cap(cap), word(0), rest(data[0]),
+        current(-1) {
     increment();
-
   }
+  BVFIterator(const uint32_t *members, size_t count)
+      : data(NULL), members(members), cap(count), word(0), rest(0),
+        current(count ? members[0] : -1) {}
   BVFIterator &operator++() {
     increment();
     return *this;
   }
-  void increment();
-  int operator*() {
+  void increment() {
+    if (members) {
+      current = ++word < cap ? members[word] : -1;
+      return;
+    }
+    while (!rest) {
+      if (++word >= cap) {
+        current = -1;
+        return;
+      }
+      rest = data[word];
+    }
+    current = word * 8 * sizeof(elem_type) + lowest_bit(rest);
+    rest &= rest - 1;
+  }
+  int operator*() const {
     return current;
   }
-  bool operator!=(const BVFIterator &other) {
+  bool operator!=(const BVFIterator &other) const {
     return (current != other.current);
   }
-  bool operator==(const BVFIterator &other) {
+  bool operator==(const BVFIterator &other) const {
     return (current == other.current);
   }
 };
 
+#include "BitExpr.hpp"
+
 #endif
@@ -0,0 +1,230 @@
+#ifndef BITWORDS_HPP__
+#define BITWORDS_HPP__
+
+#include <inttypes.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+typedef uint64_t elem_type;
+
+inline int popcount_word(elem_type w) {
+#ifdef _WIN32
+  return __popcnt64(w);
+#else
+  return __builtin_popcountll(w);
+#endif
+}
+
+// Index of the lowest set bit of a non-zero word.
+inline int lowest_bit(elem_type w) {
+#ifdef _WIN32
+  unsigned long index;
+  _BitScanForward64(&index, w);
+  return index;
+#else
+  return __builtin_ctzll(w);
+#endif
+}
+
+// Index of the highest set bit of a non-zero word.
+inline int highest_bit(elem_type w) {
+#ifdef _WIN32
+  unsigned long index;
+  _BitScanReverse64(&index, w);
+  return index;
+#else
+  return 63 - __builtin_clzll(w);
+#endif
+}
+
+// Murmur3 finalizer: a cheap bijection on 64-bit words with good avalanche.
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// A bit vector hashes to hash_seed XOR the contributions of its words. The
+// contribution of word i depends on both i and the word value, so shifted or
+// mirrored bit patterns do not cancel out, and zero words contribute nothing.
+// Changing one word updates the hash in O(1) by XORing out its old
+// contribution and XORing in the new one.
+const uint64_t hash_seed = 0x6a09e667f3bcc909ULL;
+
+inline uint64_t word_hash(size_t i, elem_type w) {
+  return w ? mix64(w ^ (i * 0x9e3779b97f4a7c15ULL + 0x632be59bd9b4e019ULL))
+           : 0;
+}
+
+// How two sets relate to each other. EQUAL sets are also subsets and
+// supersets of each other, and an empty set is reported as a SUBSET (or
+// EQUAL) of any other set.
+enum SetRelation { EQUAL, SUBSET, SUPERSET, DISJOINT, CROSSING };
+
+// Word kernels for bit vectors whose length is known at compile time.
+// BitWords<W> works on exactly W words, so every loop below has a constant
+// trip count and is unrolled into straight-line code. BitWords<0> is the
+// dynamic fallback and uses the runtime word count n instead.
+template <size_t W>
+struct BitWords {
+  static size_t words(size_t n) { return W ? W : n; }
+
+  static int popcount(const elem_type *a, size_t n) {
+    int ans = 0;
+    for (size_t i = 0; i < words(n); i++) {
+      ans += popcount_word(a[i]);
+    }
+    return ans;
+  }
+
+  static int overlap_size(const elem_type *a, const elem_type *b, size_t n) {
+    int ans = 0;
+    for (size_t i = 0; i < words(n); i++) {
+      ans += popcount_word(a[i] & b[i]);
+    }
+    return ans;
+  }
+
+  static bool equal(const elem_type *a, const elem_type *b, size_t n) {
+    elem_type diff = 0;
+    for (size_t i = 0; i < words(n); i++) {
+      diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+  }
+
+  static uint64_t hash(const elem_type *a, size_t n) {
+    uint64_t h = hash_seed;
+    for (size_t i = 0; i < words(n); i++) {
+      h ^= word_hash(i, a[i]);
+    }
+    return h;
+  }
+
+  static bool is_subset(const elem_type *a, const elem_type *b, size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      if (a[i] & ~b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool intersects(const elem_type *a, const elem_type *b, size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      if (a[i] & b[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static int and_not_count(const elem_type *a, const elem_type *b, size_t n) {
+    int ans = 0;
+    for (size_t i = 0; i < words(n); i++) {
+      ans += popcount_word(a[i] & ~b[i]);
+    }
+    return ans;
+  }
+
+  static SetRelation relation(const elem_type *a, const elem_type *b,
+                              size_t n) {
+    elem_type a_only = 0, b_only = 0, both = 0;
+    for (size_t i = 0; i < words(n); i++) {
+      a_only |= a[i] & ~b[i];
+      b_only |= b[i] & ~a[i];
+      both |= a[i] & b[i];
+      if (a_only && b_only && both) {
+        return CROSSING;
+      }
+    }
+    if (!a_only) {
+      return b_only ? SUBSET : EQUAL;
+    }
+    if (!b_only) {
+      return SUPERSET;
+    }
+    return DISJOINT;
+  }
+
+  static void and_(elem_type *out, const elem_type *a, const elem_type *b,
+                   size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      out[i] = a[i] & b[i];
+    }
+  }
+
+  static void or_(elem_type *out, const elem_type *a, const elem_type *b,
+                  size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      out[i] = a[i] | b[i];
+    }
+  }
+
+  static void and_not(elem_type *out, const elem_type *a, const elem_type *b,
+                      size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      out[i] = a[i] & ~b[i];
+    }
+  }
+
+  static void xor_(elem_type *out, const elem_type *a, const elem_type *b,
+                   size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      out[i] = a[i] ^ b[i];
+    }
+  }
+
+  static void not_(elem_type *out, const elem_type *a, size_t n) {
+    for (size_t i = 0; i < words(n); i++) {
+      out[i] = ~a[i];
+    }
+  }
+};
+
+// Word counts with a dedicated BitWords instantiation. Bit vectors of up to
+// max_fixed_words words are padded to the next entry so that they always hit
+// one of them.
+const size_t max_fixed_words = 16;
+
+inline size_t fixed_words_for(size_t words) {
+  if (words > max_fixed_words) {
+    return words;
+  }
+  size_t w = 1;
+  while (w < words) {
+    w *= 2;
+  }
+  return w;
+}
+
+// Calls Kernel<W>::run with the instantiation matching the word count n. The
+// switch is a single well-predicted branch when, as in every clade loop over
+// one taxon set, all bit vectors have the same width.
+template <template <size_t> class Kernel, class... Args>
+inline auto dispatch_words(size_t n, Args... args)
+    -> decltype(Kernel<0>::run(args..., n)) {
+  switch (n) {
+    case 1:
+      return Kernel<1>::run(args..., n);
+    case 2:
+      return Kernel<2>::run(args..., n);
+    case 4:
+      return Kernel<4>::run(args..., n);
+    case 8:
+      return Kernel<8>::run(args..., n);
+    case 16:
+      return Kernel<16>::run(args..., n);
+    default:
+      return Kernel<0>::run(args..., n);
+  }
+}
+
+#endif  // BITWORDS_HPP__
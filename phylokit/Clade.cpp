@@ -5,14 +5,14 @@
 #include <algorithm>
 #include <cstring>
 #include <cmath>
+#include <utility>
 
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string.hpp>
 
 Clade::Clade(TaxonSet &ts_, const std::string &str) :
     taxa(ts_.size()),
-    ts_(&ts_),
-    sz(0) {
+    ts_(&ts_) {
 
   typedef boost::tokenizer<boost::char_separator<char>>
       tokenizer;
@@ -27,26 +27,36 @@ Clade::Clade(TaxonSet &ts_, const std::string &str) :
 
 Clade::Clade(const TaxonSet &ts_) :
     taxa(ts_.size()),
-    ts_(&ts_),
-    sz(0) {}
+    ts_(&ts_) {}
+
+Clade::Clade(const TaxonSet &ts_, CladeArena *arena) :
+    taxa(ts_.size(), arena),
+    ts_(&ts_) {}
+
+Clade::Clade(const Clade &other, CladeArena *arena) :
+    taxa(other.taxa, arena),
+    ts_(&other.ts()) {
+}
 
 Clade::Clade(const TaxonSet &ts_, Taxon t) :
     taxa(ts_.size()),
-    ts_(&ts_),
-    sz(0) {
+    ts_(&ts_) {
   add(t);
 }
 
 Clade::Clade(const TaxonSet &ts_, const clade_bitset &taxa) :
     taxa(taxa),
-    ts_(&ts_),
-    sz(taxa.popcount()) {
+    ts_(&ts_) {
+}
+
+Clade::Clade(const TaxonSet &ts_, clade_bitset &&taxa) :
+    taxa(std::move(taxa)),
+    ts_(&ts_) {
 }
 
 Clade::Clade(const TaxonSet &ts_, const std::unordered_set<Taxon> &taxa) :
     taxa(ts_.size()),
-    ts_(&ts_),
-    sz(taxa.size()) {
+    ts_(&ts_) {
   for (Taxon t : taxa) {
     add(t);
   }
@@ -54,14 +64,23 @@ Clade::Clade(const TaxonSet &ts_, const std::unordered_set<Taxon> &taxa) :
 
 Clade::Clade(const Clade &other) :
     taxa(other.taxa),
-    ts_(&other.ts()),
-    sz(other.sz) {
+    ts_(&other.ts()) {
+}
+
+Clade::Clade(Clade &&other) noexcept :
+    taxa(std::move(other.taxa)),
+    ts_(other.ts_) {
 }
 
 Clade &Clade::operator=(const Clade &other) {
   taxa = other.taxa;
   ts_ = other.ts_;
-  sz = other.sz;
+  return *this;
+}
+
+Clade &Clade::operator=(Clade &&other) noexcept {
+  taxa = std::move(other.taxa);
+  ts_ = other.ts_;
   return *this;
 }
 
@@ -96,87 +115,137 @@ int Clade::overlap_size(const Clade &other) const {
   return taxa.overlap_size(other.taxa);
 }
 
+Clade Clade::restrict_to(const TaxonSet &compact,
+                         const RankSelect &index) const {
+  Clade c(compact);
+  for (Taxon t : taxa) {
+    int r = index.rank(t);
+    if (index.rank(t + 1) != r) {
+      c.add(r);
+    }
+  }
+  return c;
+}
+
+Clade Clade::expand_to(const TaxonSet &full, const RankSelect &index) const {
+  Clade c(full);
+  for (Taxon t : taxa) {
+    c.add(index.select(t));
+  }
+  return c;
+}
+
+TaxonSet compact_taxon_set(const Clade &taxa) {
+  TaxonSet compact(taxa.size());
+  for (Taxon t : taxa) {
+    TaxonName name = taxa.ts()[t];
+    compact.add(name.data(), name.size());
+  }
+  return compact;
+}
+
 bool Clade::contains(const Clade &other) const {
-  return (other.taxa & taxa) == other.taxa;
+  return other.taxa.is_subset_of(taxa);
 }
 
 bool Clade::contains(const Taxon taxon) const {
   return taxa.get(taxon);
 }
 
+bool Clade::disjoint(const Clade &other) const {
+  return taxa.is_disjoint(other.taxa);
+}
+
+SetRelation Clade::relation(const Clade &other) const {
+  return taxa.relation(other.taxa);
+}
+
 bool Clade::compatible(const Clade &other) const {
-  return contains(other) || other.contains(*this) || overlap_size(other) == 0;
+  return relation(other) != CROSSING;
 }
 
 bool Clade::compatible(const Clade &other, const Clade &restr) const {
-  return contains(other) || other.contains(*this) || overlap_size(other) == 0;
+  return relation(other) != CROSSING;
 }
 
 void Clade::add(const Taxon taxon) {
   taxa.set(taxon);
-  sz++;
 }
 
 void Clade::remove(const Taxon taxon) {
   taxa.unset(taxon);
-  sz--;
 }
 
 void Clade::add(const Clade &other) {
   taxa |= other.taxa;
-  sz = taxa.popcount();
 }
 
 void Clade::remove(const Clade &other) {
-  taxa &= ~other.taxa;
-  sz = taxa.popcount();
-
+  taxa -= other.taxa;
 }
 
 Clade Clade::complement() const {
-  BitVectorFixed comp = ts().taxa_bs & (~taxa);
-  Clade c(ts(), comp);
-  return c;
+  return Clade(ts(), lazy(ts().taxa_bs) - taxa);
 }
 
 Clade Clade::minus(const Clade &other) const {
-  BitVectorFixed m(taxa & (~other.taxa));
-  Clade c(ts(), m);
+  Clade c(*this);
+  c.remove(other);
   return c;
 }
 Clade Clade::plus(const Clade &other) const {
-  BitVectorFixed m(taxa | other.taxa);
-  Clade c(ts(), m);
+  Clade c(*this);
+  c.add(other);
   return c;
 }
 
 Clade Clade::minus(const Taxon other) const {
-  Clade c(ts(), taxa);
+  Clade c(*this);
   c.remove(other);
   return c;
 }
 Clade Clade::plus(const Taxon other) const {
-  Clade c(ts(), taxa);
+  Clade c(*this);
   c.add(other);
   return c;
 }
 
-Clade Clade::operator+(const Clade &other) const {
+Clade Clade::operator+(const Clade &other) const & {
   return plus(other);
 }
 
-Clade Clade::operator-(const Clade &other) const {
+Clade Clade::operator-(const Clade &other) const & {
   return minus(other);
 }
 
-Clade Clade::operator+(const Taxon other) const {
+Clade Clade::operator+(const Taxon other) const & {
   return plus(other);
 }
 
-Clade Clade::operator-(const Taxon other) const {
+Clade Clade::operator-(const Taxon other) const & {
   return minus(other);
 }
 
+Clade Clade::operator+(const Clade &other) && {
+  add(other);
+  return std::move(*this);
+}
+
+Clade Clade::operator-(const Clade &other) && {
+  remove(other);
+  return std::move(*this);
+}
+
+Clade Clade::operator+(const Taxon other) && {
+  add(other);
+  return std::move(*this);
+}
+
+Clade Clade::operator-(const Taxon other) && {
+  remove(other);
+  return std::move(*this);
+}
+
 Clade &Clade::operator-=(const Clade &other) {
   remove(other);
   return *this;
@@ -200,17 +269,36 @@ std::ostream &operator<<(std::ostream &os, const Clade &c) {
 }
 
 int Clade::size() const {
-  return sz;
+  return taxa.popcount();
 }
 
 void Clade::do_swap(Clade &other) {
   std::swap(taxa, other.taxa);
-  std::swap(sz, other.sz);
 }
 
 std::string Bipartition::str() const {
   return "{" + a1.str() + " " + a2.str() + "}";
 }
 
+static bool holds_reference(const Clade &side, const Clade &taxa) {
+  int reference = taxa.get_taxa().ffs();
+  return reference >= 0 && side.contains(reference);
+}
+
+Split::Split(const Clade &side, const Clade &taxa) :
+    side_(holds_reference(side, taxa) ? Clade(taxa.ts(), lazy(taxa) - side)
+                                      : side) {
+}
+
+Split::Split(Clade &&side, const Clade &taxa) :
+    side_(holds_reference(side, taxa) ? Clade(taxa.ts(), lazy(taxa) - side)
+                                      : std::move(side)) {
+}
+
+bool Split::trivial(int ntaxa) const {
+  int n = side_.size();
+  return n < 2 || ntaxa - n < 2;
+}
+
 
 
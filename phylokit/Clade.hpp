@@ -1,6 +1,7 @@
 #ifndef CLADE_HPP__
 #define CLADE_HPP__
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <bitset>
@@ -8,6 +9,8 @@
 #include <cassert>
 #include <unordered_map>
 #include <string.h>
+#include "CladeArena.hpp"
+#include "RankSelect.hpp"
 #include "TaxonSet.hpp"
 
 class Clade {
@@ -16,24 +19,45 @@ class Clade {
   clade_bitset taxa;
   const TaxonSet *ts_;
 
-  int sz;
-
  public:
 
   Clade(TaxonSet &ts, const std::string &str);
   Clade(const TaxonSet &ts, Taxon t);
   Clade(const TaxonSet &ts, const clade_bitset &taxa);
+  Clade(const TaxonSet &ts, clade_bitset &&taxa);
   Clade(const TaxonSet &ts, const std::unordered_set<Taxon> &taxa);
   Clade(const TaxonSet &ts);
+  // Clades whose bitset storage comes from arena; see BitVectorFixed.
+  Clade(const TaxonSet &ts, CladeArena *arena);
+  Clade(const Clade &other, CladeArena *arena);
   Clade(const Clade &other);
+  Clade(Clade &&other) noexcept;
+  // Evaluates a lazy set expression (see BitExpr.hpp) over clades of ts.
+  template <class E>
+  Clade(const TaxonSet &ts, const BitExpr<E> &e)
+      : taxa(e.self().size()), ts_(&ts) {
+    taxa = e;
+  }
 
   Clade &operator=(const Clade &other);
+  Clade &operator=(Clade &&other) noexcept;
+  // The clade may be an operand of e, as in c = lazy(c) - other.
+  template <class E>
+  Clade &operator=(const BitExpr<E> &e) {
+    taxa = e;
+    return *this;
+  }
   bool operator==(const Clade &other) const;
+  // The order of the clades' bitsets; see BitVectorFixed::compare.
+  bool operator<(const Clade &other) const { return taxa < other.taxa; }
+  int compare(const Clade &other) const { return taxa.compare(other.taxa); }
 
   std::string str() const;
 
   bool contains(const Clade &other) const;
   bool contains(const Taxon taxon) const;
+  bool disjoint(const Clade &other) const;
+  SetRelation relation(const Clade &other) const;
 
   bool compatible(const Clade &other) const;
   bool compatible(const Clade &other, const Clade &restr) const;
@@ -41,6 +65,17 @@ class Clade {
   Clade overlap(const Clade &other) const;
   int overlap_size(const Clade &other) const;
 
+  // Renumbers the clade onto a compact taxon set in which taxon k is the
+  // taxon of rank k in index, as built by compact_taxon_set; taxa that index
+  // does not hold are dropped. expand_to maps a clade of the compact taxon
+  // set back onto the full one.
+  Clade restrict_to(const TaxonSet &compact, const RankSelect &index) const;
+  Clade expand_to(const TaxonSet &full, const RankSelect &index) const;
+  // Moves each taxon t to order[t], after TaxonSet::renumber.
+  void renumber(const std::vector<Taxon> &order) {
+    taxa.permute(order.data(), order.size());
+  }
+
   static void test();
 
   void add(const Taxon taxon);
@@ -58,12 +93,18 @@ class Clade {
   Clade &operator-=(const Taxon other);
   Clade &operator+=(const Taxon other);
 
-  Clade operator-(const Clade &other) const;
-  Clade operator+(const Clade &other) const;
-  Clade operator-(const Taxon other) const;
-  Clade operator+(const Taxon other) const;
+  // The rvalue overloads reuse the left operand's bitset.
+  Clade operator-(const Clade &other) const &;
+  Clade operator+(const Clade &other) const &;
+  Clade operator-(const Taxon other) const &;
+  Clade operator+(const Taxon other) const &;
+  Clade operator-(const Clade &other) &&;
+  Clade operator+(const Clade &other) &&;
+  Clade operator-(const Taxon other) &&;
+  Clade operator+(const Taxon other) &&;
 
   const TaxonSet &ts() const { return *ts_; }
+  // Counted from the bitset, which for sparse clades keeps the count.
   int size() const;
   const clade_bitset &get_taxa() const { return taxa; }
 
@@ -85,6 +126,14 @@ class Clade {
 
 std::ostream &operator<<(std::ostream &os, const Clade &c);
 
+// Clades as operands of lazy set expressions; see BitExpr.hpp.
+inline BitLeaf lazy(const Clade &c) { return BitLeaf(c.get_taxa()); }
+inline BitLeaf to_bit_expr(const Clade &c) { return BitLeaf(c.get_taxa()); }
+
+// A taxon set holding the taxa of clade, numbered in the order of their
+// numbers in the clade's taxon set, for Clade::restrict_to.
+TaxonSet compact_taxon_set(const Clade &taxa);
+
 template<class c>
 struct TripartitionG {
   c a1, a2, rest;
@@ -94,9 +143,9 @@ struct TripartitionG {
       rest(clade.complement()) {}
 
   std::string str() const {
-    assert(a1.overlap(rest).size() == 0);
-    assert(a2.overlap(rest).size() == 0);
-    assert(a2.overlap(a1).size() == 0);
+    assert(!(lazy(a1) & rest).any());
+    assert(!(lazy(a2) & rest).any());
+    assert(!(lazy(a2) & a1).any());
     return "{" + a1.str() + "/" + a2.str() + "/" + rest.str() + "}";
   }
 };
@@ -108,13 +157,46 @@ struct Bipartition {
   Bipartition(const Clade &clade1, const Clade &clade2) :
       a1(clade1),
       a2(clade2) {}
-  size_t hash() const { return a1.hash() ^ a2.hash(); }
+  // Symmetric in a1 and a2, like operator==, without letting equal sides
+  // cancel out the way a plain XOR would.
+  size_t hash() const {
+    size_t h1 = a1.hash(), h2 = a2.hash();
+    return mix64(std::min(h1, h2) ^ mix64(std::max(h1, h2)));
+  }
   bool operator==(const Bipartition &other) const {
     return ((a1 == other.a1) && (a2 == other.a2)) || ((a2 == other.a1) && (a1 == other.a2));
   }
   std::string str() const;
 };
 
+// An unrooted split of a taxon set into two sides. Only the side without the
+// set's reference taxon, its lowest-numbered one, is stored, so both
+// orientations of a bipartition give the same Split and comparing or
+// hashing one is a single pass over one bit vector.
+class Split {
+ public:
+  // side must be a subset of taxa; either side of the split will do.
+  Split(const Clade &side, const Clade &taxa);
+  Split(Clade &&side, const Clade &taxa);
+
+  const Clade &side() const { return side_; }
+  Clade other_side(const Clade &taxa) const {
+    return Clade(taxa.ts(), lazy(taxa) - side_);
+  }
+  // Whether either side holds fewer than two taxa. Loops over many splits
+  // of one taxon set can count it once and pass the count.
+  bool trivial(const Clade &taxa) const { return trivial(taxa.size()); }
+  bool trivial(int ntaxa) const;
+
+  bool operator==(const Split &other) const { return side_ == other.side_; }
+  bool operator!=(const Split &other) const { return !(*this == other); }
+  size_t hash() const { return side_.hash(); }
+  std::string str() const { return side_.str(); }
+
+ private:
+  Clade side_;
+};
+
 namespace std {
 template<>
 struct hash<Clade> {
@@ -129,6 +211,13 @@ struct hash<Bipartition> {
     return bp.hash();
   }
 };
+
+template<>
+struct hash<Split> {
+  size_t operator()(const Split &s) const {
+    return s.hash();
+  }
+};
 }
 
 #endif // CLADE_HPP__
@@ -0,0 +1,48 @@
+#include "CladeArena.hpp"
+
+#include <cassert>
+
+CladeArena::CladeArena(size_t slab_bytes)
+    : slab_bytes(slab_bytes),
+      next(NULL),
+      end(NULL),
+      allocated(0),
+      reserved(0) {}
+
+CladeArena::~CladeArena() {
+  clear();
+}
+
+char *CladeArena::new_slab(size_t bytes) {
+  char *slab = new char[bytes];
+  slabs.push_back(slab);
+  reserved += bytes;
+  return slab;
+}
+
+void *CladeArena::allocate(size_t bytes) {
+  bytes = (bytes + sizeof(elem_type) - 1) & ~(sizeof(elem_type) - 1);
+  allocated += bytes;
+  if (bytes > (size_t) (end - next)) {
+    // Big blocks get a slab of their own so the current slab keeps serving
+    // small ones.
+    if (bytes > slab_bytes / 4) {
+      return new_slab(bytes);
+    }
+    next = new_slab(slab_bytes);
+    end = next + slab_bytes;
+  }
+  void *block = next;
+  next += bytes;
+  assert(next <= end);
+  return block;
+}
+
+void CladeArena::clear() {
+  for (char *slab : slabs) {
+    delete[] slab;
+  }
+  slabs.clear();
+  next = end = NULL;
+  allocated = reserved = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef CLADEARENA_HPP__
+#define CLADEARENA_HPP__
+
+#include <cstdlib>
+#include <vector>
+
+#include "BitWords.hpp"
+
+// Hands out the heap storage of bit vectors (the words of wide dense clades
+// and the member arrays of sparse ones) from large slabs, so the clades of one
+// tree or one collection sit next to each other in memory and are freed in
+// one shot. Bit vectors built with an arena never free their storage; it goes
+// away with the arena, which therefore has to outlive them. A bit vector that
+// outgrows its storage leaves the old block in the arena until then.
+class CladeArena {
+ public:
+  static const size_t default_slab_bytes = 64 * 1024;
+
+  explicit CladeArena(size_t slab_bytes = default_slab_bytes);
+  ~CladeArena();
+  CladeArena(const CladeArena &) = delete;
+  CladeArena &operator=(const CladeArena &) = delete;
+
+  // 8-byte aligned.
+  void *allocate(size_t bytes);
+  elem_type *allocate_words(size_t n) {
+    return static_cast<elem_type *>(allocate(n * sizeof(elem_type)));
+  }
+  uint32_t *allocate_members(size_t n) {
+    return static_cast<uint32_t *>(allocate(n * sizeof(uint32_t)));
+  }
+
+  // Frees all slabs at once. Bit vectors that used the arena may still be
+  // destroyed afterwards, since they never free arena storage, but nothing
+  // else.
+  void clear();
+
+  size_t bytes_allocated() const { return allocated; }
+  size_t bytes_reserved() const { return reserved; }
+
+ private:
+  char *new_slab(size_t bytes);
+
+  size_t slab_bytes;
+  std::vector<char *> slabs;
+  char *next;
+  char *end;
+  size_t allocated;
+  size_t reserved;
+};
+
+#endif
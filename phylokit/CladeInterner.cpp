@@ -0,0 +1,54 @@
+#include "CladeInterner.hpp"
+
+namespace {
+
+const size_t initial_slots = 64;
+
+}  // namespace
+
+CladeInterner::CladeInterner(const TaxonSet &ts)
+    : ts_(&ts), slots(initial_slots, 0) {}
+
+size_t CladeInterner::probe(const Clade &clade, size_t hash) const {
+  size_t mask = slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    uint32_t slot = slots[i];
+    if (!slot ||
+        (hashes[slot - 1] == hash && clades[slot - 1] == clade)) {
+      return i;
+    }
+  }
+}
+
+uint32_t CladeInterner::intern(const Clade &clade) {
+  size_t hash = clade.hash();
+  size_t i = probe(clade, hash);
+  if (slots[i]) {
+    return slots[i] - 1;
+  }
+  uint32_t id = clades.size();
+  clades.emplace_back(clade, &arena);
+  hashes.push_back(hash);
+  slots[i] = id + 1;
+  if (2 * clades.size() > slots.size()) {
+    grow();
+  }
+  return id;
+}
+
+int CladeInterner::find(const Clade &clade) const {
+  uint32_t slot = slots[probe(clade, clade.hash())];
+  return (int) slot - 1;
+}
+
+void CladeInterner::grow() {
+  slots.assign(2 * slots.size(), 0);
+  size_t mask = slots.size() - 1;
+  for (uint32_t id = 0; id < clades.size(); id++) {
+    size_t i = hashes[id] & mask;
+    while (slots[i]) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = id + 1;
+  }
+}
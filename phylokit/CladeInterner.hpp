@@ -0,0 +1,48 @@
+#ifndef CLADEINTERNER_HPP__
+#define CLADEINTERNER_HPP__
+
+#include <vector>
+
+#include "Clade.hpp"
+#include "CladeArena.hpp"
+
+// Deduplicates clades over one taxon set and numbers them 0, 1, 2, ... in the
+// order they were first interned, so code that keeps per-clade data can use
+// flat arrays indexed by id instead of maps keyed by clade. Each clade is
+// hashed and compared once, when it is interned. The interned clades sit in
+// one vector and their bitsets in the interner's own arena; the table is
+// open addressing with linear probing over ids, checking cached hashes before
+// comparing bitsets.
+class CladeInterner {
+ public:
+  explicit CladeInterner(const TaxonSet &ts);
+  CladeInterner(const CladeInterner &) = delete;
+  CladeInterner &operator=(const CladeInterner &) = delete;
+
+  // The id of clade, interning a copy of it if it is new.
+  uint32_t intern(const Clade &clade);
+  // The id of clade, or -1 if it has not been interned.
+  int find(const Clade &clade) const;
+  bool contains(const Clade &clade) const { return find(clade) >= 0; }
+
+  size_t size() const { return clades.size(); }
+  const Clade &operator[](uint32_t id) const { return clades[id]; }
+  std::vector<Clade>::const_iterator begin() const { return clades.begin(); }
+  std::vector<Clade>::const_iterator end() const { return clades.end(); }
+  const TaxonSet &ts() const { return *ts_; }
+
+ private:
+  // The slot holding clade, or the empty slot where it would go.
+  size_t probe(const Clade &clade, size_t hash) const;
+  void grow();
+
+  const TaxonSet *ts_;
+  CladeArena arena;
+  std::vector<Clade> clades;
+  std::vector<size_t> hashes;
+  // A power of two in size, at most half full. Slots hold an id plus one,
+  // or 0 if empty.
+  std::vector<uint32_t> slots;
+};
+
+#endif  // CLADEINTERNER_HPP__
@@ -0,0 +1,410 @@
+#include "CladeSet.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Buckets below this size are sorted by comparison.
+const size_t radix_min = 64;
+// Pending wide clades allowed before insert() compacts, at least.
+const size_t compact_min = 1 << 16;
+// Slots the table of pending rows starts with, a power of two.
+const size_t row_index_min = 1 << 10;
+// Words of the widest row.
+const size_t max_row_words =
+    BitVectorFixed::sparse_min_bits / (8 * sizeof(elem_type));
+
+// Rows of nwords words, one per clade, compared like BitVectorFixed::compare
+// compares bit vectors of equal size.
+struct WordRows {
+  const elem_type *keys;
+  size_t nwords;
+
+  const elem_type *row(uint32_t i) const { return keys + i * nwords; }
+  bool less(uint32_t a, uint32_t b) const {
+    return std::lexicographical_compare(row(a), row(a) + nwords, row(b),
+                                        row(b) + nwords);
+  }
+  bool equal(uint32_t a, uint32_t b) const {
+    return std::equal(row(a), row(a) + nwords, row(b));
+  }
+};
+
+// A row and its word being sorted on, kept together so radix passes read
+// them front to back rather than chasing rows.
+typedef std::pair<elem_type, uint32_t> Item;
+
+// Sorts items[lo, hi), whose rows agree on the words before word and the
+// bytes of word before byte, counting bytes from the most significant.
+// scratch is shared by the recursion.
+void sort_bytes(const WordRows &rows, Item *items, size_t lo, size_t hi,
+                size_t word, size_t byte, std::vector<Item> &scratch) {
+  while (hi - lo >= radix_min) {
+    if (byte == sizeof(elem_type)) {
+      if (++word == rows.nwords) {
+        return;
+      }
+      byte = 0;
+      for (size_t i = lo; i < hi; i++) {
+        items[i].first = rows.row(items[i].second)[word];
+      }
+    }
+    // Skip the bytes the whole bucket shares, and split off the zero words,
+    // which come first: words of small clades are mostly zero, and byte
+    // passes over them would find nothing.
+    elem_type all_or = 0, all_and = ~(elem_type) 0;
+    size_t zeros = 0;
+    for (size_t i = lo; i < hi; i++) {
+      all_or |= items[i].first;
+      all_and &= items[i].first;
+      zeros += !items[i].first;
+    }
+    if (zeros && zeros < hi - lo) {
+      size_t z = lo, nz = lo + zeros;
+      for (size_t i = lo; i < hi; i++) {
+        scratch[items[i].first ? nz++ : z++] = items[i];
+      }
+      std::copy(scratch.begin() + lo, scratch.begin() + hi, items + lo);
+      sort_bytes(rows, items, lo, lo + zeros, word, sizeof(elem_type),
+                 scratch);
+      lo += zeros;
+      continue;
+    }
+    elem_type diff = all_or ^ all_and;
+    if (!diff) {
+      byte = sizeof(elem_type);
+      continue;
+    }
+    byte = std::max(byte, (size_t) (63 - highest_bit(diff)) / 8);
+    int shift = 8 * (sizeof(elem_type) - 1 - byte);
+    size_t offsets[257] = {0};
+    for (size_t i = lo; i < hi; i++) {
+      offsets[((items[i].first >> shift) & 0xff) + 1]++;
+    }
+    for (int b = 0; b < 256; b++) {
+      offsets[b + 1] += offsets[b];
+    }
+    size_t ends[256];
+    std::copy(offsets + 1, offsets + 257, ends);
+    for (size_t i = lo; i < hi; i++) {
+      scratch[lo + offsets[(items[i].first >> shift) & 0xff]++] = items[i];
+    }
+    std::copy(scratch.begin() + lo, scratch.begin() + hi, items + lo);
+    // Recurse into each bucket but the last, which the loop continues with.
+    size_t begin = 0;
+    int last = 255;
+    while (ends[last] == ends[last - 1]) last--;
+    for (int b = 0; b < last; b++) {
+      if (ends[b] - begin > 1) {
+        sort_bytes(rows, items, lo + begin, lo + ends[b], word, byte + 1,
+                   scratch);
+      }
+      begin = ends[b];
+    }
+    lo += begin;
+    byte++;
+  }
+  if (hi - lo > 1) {
+    std::sort(items + lo, items + hi, [&rows](const Item &a, const Item &b) {
+      return rows.less(a.second, b.second);
+    });
+  }
+}
+
+size_t words_for(size_t bits) {
+  return (bits + 8 * sizeof(elem_type) - 1) / (8 * sizeof(elem_type));
+}
+
+// Compares rows of nwords words like BitVectorFixed::compare.
+int compare_words(const elem_type *a, const elem_type *b, size_t nwords) {
+  for (size_t w = 0; w < nwords; w++) {
+    if (a[w] != b[w]) {
+      return a[w] < b[w] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// Moves down the search tree from node 1 to past a leaf, going right at
+// each node less than the query, then returns the node of the first clade
+// not less than the query, or 0 if there is none.
+template <class Less>
+size_t descend(size_t n, Less less) {
+  size_t k = 1;
+  while (k <= n) {
+    k = 2 * k + less(k);
+  }
+  // Undo the right turns taken after the last left turn.
+  return k >> (lowest_bit(~(elem_type) k) + 1);
+}
+
+}  // namespace
+
+CladeSet::CladeSet(const TaxonSet &ts) : ts_(&ts), rows_bits(0) {}
+
+CladeSet::CladeSet(const TaxonSet &ts,
+                   const std::unordered_set<Clade> &clades)
+    : CladeSet(ts) {
+  for (const Clade &c : clades) {
+    insert(c);
+  }
+  build();
+}
+
+bool CladeSet::built() const {
+  return !pending() && eytzinger.size() == clades.size() + 1;
+}
+
+size_t CladeSet::pending() const {
+  return wide.size() + (rows_bits ? rows.size() / words_for(rows_bits) : 0);
+}
+
+void CladeSet::insert(const Clade &clade) {
+  const clade_bitset &bits = clade.get_taxa();
+  // Clades over no taxa have no words to make a row of.
+  if (bits.size >= BitVectorFixed::sparse_min_bits || !bits.size) {
+    wide.push_back(clade);
+  } else {
+    if (bits.size != rows_bits) {
+      // The rows, words and search keys are all of the old size.
+      compact();
+      words.clear();
+    }
+    rows_bits = bits.size;
+    size_t nwords = words_for(rows_bits);
+    size_t n = rows.size(), row = n / nwords;
+    if (2 * (row + 1) > row_index.size()) {
+      index_rows(std::max(2 * row_index.size(), row_index_min));
+    }
+    rows.resize(n + nwords);
+    bits.copy_words(&rows[n]);
+    // A slot holds the low half of the clade's hash above 1 + its row.
+    uint64_t hash = (uint32_t) clade.hash();
+    size_t mask = row_index.size() - 1;
+    for (size_t h = hash & mask;; h = (h + 1) & mask) {
+      uint64_t slot = row_index[h];
+      if (!slot) {
+        row_index[h] = hash << 32 | (row + 1);
+        break;
+      }
+      const elem_type *other = &rows[((uint32_t) slot - 1) * nwords];
+      if (slot >> 32 == hash &&
+          std::equal(&rows[n], &rows[n] + nwords, other)) {
+        rows.resize(n);
+        return;
+      }
+    }
+  }
+  // The rows hold no duplicates, so only the wide clades need merging to
+  // keep memory in line with the distinct clades.
+  if (wide.size() >= std::max(4 * clades.size(), compact_min)) {
+    compact();
+  }
+}
+
+void CladeSet::index_rows(size_t slots) {
+  std::vector<uint64_t> old(slots, 0);
+  old.swap(row_index);
+  for (uint64_t slot : old) {
+    if (!slot) continue;
+    size_t h = slot >> 32 & (slots - 1);
+    while (row_index[h]) {
+      h = (h + 1) & (slots - 1);
+    }
+    row_index[h] = slot;
+  }
+}
+
+std::vector<uint32_t> CladeSet::sorted_rows() const {
+  std::vector<uint32_t> ans;
+  if (rows.empty()) {
+    return ans;
+  }
+  size_t nwords = words_for(rows_bits);
+  size_t n = rows.size() / nwords;
+  // A row whose first nonzero word is w sorts after every row whose first
+  // nonzero word comes later, so bucket the rows by w first. Small clades
+  // over many taxa are mostly zero words, which the byte passes would
+  // otherwise crawl through.
+  std::vector<size_t> offsets(nwords + 2, 0);
+  std::vector<uint32_t> first(n);
+  for (size_t i = 0; i < n; i++) {
+    const elem_type *row = &rows[i * nwords];
+    size_t w = 0;
+    while (w < nwords && !row[w]) w++;
+    first[i] = w;
+    offsets[nwords - w + 1]++;
+  }
+  for (size_t b = 0; b <= nwords; b++) {
+    offsets[b + 1] += offsets[b];
+  }
+  std::vector<Item> items(n), scratch(n);
+  for (size_t i = 0; i < n; i++) {
+    size_t w = first[i];
+    items[offsets[nwords - w]++] =
+        Item(w < nwords ? rows[i * nwords + w] : 0, i);
+  }
+  WordRows sorter = {rows.data(), nwords};
+  // Bucket 0 holds the empty rows, which are all equal.
+  for (size_t b = 1, lo = offsets[0]; b <= nwords; lo = offsets[b++]) {
+    sort_bytes(sorter, items.data(), lo, offsets[b], nwords - b, 0, scratch);
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (!i || !sorter.equal(items[i - 1].second, items[i].second)) {
+      ans.push_back(items[i].second);
+    }
+  }
+  return ans;
+}
+
+int CladeSet::compare_row(const Clade &clade, const elem_type *row,
+                          elem_type *buf) const {
+  const clade_bitset &bits = clade.get_taxa();
+  if (bits.size != rows_bits) {
+    return bits.size < rows_bits ? -1 : 1;
+  }
+  bits.copy_words(buf);
+  return compare_words(buf, row, words_for(rows_bits));
+}
+
+Clade CladeSet::row_clade(const elem_type *row) const {
+  clade_bitset bits(rows_bits);
+  bits.assign_words(row);
+  return Clade(*ts_, std::move(bits));
+}
+
+void CladeSet::compact() {
+  eytzinger.clear();
+  keys.clear();
+  std::vector<Clade> merged;
+  // Merge the rows in first, turning only the new ones into clades. While
+  // the clades have their words, the merge compares those.
+  std::vector<uint32_t> order = sorted_rows();
+  if (order.size()) {
+    size_t nwords = words_for(rows_bits);
+    bool flat = clades.empty() || words.size();
+    std::vector<elem_type> buf(nwords), merged_words;
+    merged.reserve(clades.size() + order.size());
+    if (flat) {
+      merged_words.reserve(merged.capacity() * nwords);
+    }
+    size_t i = 0, j = 0;
+    while (i < clades.size() || j < order.size()) {
+      const elem_type *row = j < order.size() ? &rows[order[j] * nwords] : NULL;
+      int cmp = !row ? -1
+                : i == clades.size() ? 1
+                : flat ? compare_words(&words[i * nwords], row, nwords)
+                       : compare_row(clades[i], row, buf.data());
+      if (cmp <= 0) {
+        if (flat) {
+          merged_words.insert(merged_words.end(), &words[i * nwords],
+                              &words[i * nwords] + nwords);
+        }
+        merged.push_back(std::move(clades[i++]));
+        j += cmp == 0;
+      } else {
+        if (flat) {
+          merged_words.insert(merged_words.end(), row, row + nwords);
+        }
+        merged.push_back(row_clade(row));
+        j++;
+      }
+    }
+    clades.swap(merged);
+    words.swap(merged_words);
+    rows.clear();
+    std::fill(row_index.begin(), row_index.end(), 0);
+  }
+
+  if (wide.size()) {
+    std::sort(wide.begin(), wide.end());
+    merged.clear();
+    merged.reserve(clades.size() + wide.size());
+    size_t i = 0, j = 0;
+    while (i < clades.size() || j < wide.size()) {
+      int cmp = j == wide.size() ? -1
+                : i == clades.size() ? 1
+                : clades[i].compare(wide[j]);
+      if (cmp <= 0) {
+        merged.push_back(std::move(clades[i++]));
+      } else {
+        merged.push_back(std::move(wide[j++]));
+      }
+      // Skip wide clades already in the set, or repeated.
+      while (j < wide.size() && merged.size() && merged.back() == wide[j]) {
+        j++;
+      }
+    }
+    clades.swap(merged);
+    words.clear();
+    wide.clear();
+  }
+}
+
+void CladeSet::build() {
+  compact();
+
+  // Fill the search tree in order, so an in-order walk visits the clades
+  // sorted.
+  eytzinger.assign(clades.size() + 1, 0);
+  size_t next = 0;
+  std::vector<size_t> stack;
+  size_t k = 1;
+  while (k < eytzinger.size() || !stack.empty()) {
+    if (k < eytzinger.size()) {
+      stack.push_back(k);
+      k = 2 * k;
+    } else {
+      k = stack.back();
+      stack.pop_back();
+      eytzinger[k] = next++;
+      k = 2 * k + 1;
+    }
+  }
+
+  if (words.size()) {
+    size_t nwords = words_for(rows_bits);
+    keys.resize(eytzinger.size() * nwords);
+    for (size_t k = 1; k < eytzinger.size(); k++) {
+      std::copy(&words[eytzinger[k] * nwords],
+                &words[eytzinger[k] * nwords] + nwords, &keys[k * nwords]);
+    }
+  }
+}
+
+int CladeSet::find(const Clade &clade) const {
+  size_t n = clades.size();
+  if (eytzinger.size() != n + 1) {
+    // insert() compacted since the last build(), which leaves the search
+    // tree out of date; the sorted clades are still valid.
+    auto it = std::lower_bound(clades.begin(), clades.end(), clade);
+    return it != clades.end() && *it == clade ? it - clades.begin() : -1;
+  }
+  size_t k;
+  if (keys.size()) {
+    const clade_bitset &bits = clade.get_taxa();
+    if (bits.size != rows_bits) {
+      return -1;
+    }
+    size_t nwords = words_for(rows_bits);
+    elem_type query[max_row_words];
+    bits.copy_words(query);
+    k = descend(n, [&](size_t node) {
+      const elem_type *key = &keys[node * nwords];
+      return std::lexicographical_compare(key, key + nwords, query,
+                                          query + nwords);
+    });
+    if (k == 0 || !std::equal(query, query + nwords, &keys[k * nwords])) {
+      return -1;
+    }
+  } else {
+    k = descend(n, [&](size_t node) {
+      return clades[eytzinger[node]] < clade;
+    });
+    if (k == 0 || !(clades[eytzinger[k]] == clade)) {
+      return -1;
+    }
+  }
+  return eytzinger[k];
+}
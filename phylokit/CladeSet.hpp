@@ -0,0 +1,88 @@
+#ifndef CLADESET_HPP__
+#define CLADESET_HPP__
+
+#include <unordered_set>
+#include <vector>
+
+#include "Clade.hpp"
+
+// A set of clades kept as a sorted vector, for bulk workloads: collect the
+// clades of many trees with insert(), then build() once to sort them and drop
+// duplicates. insert() copies the words of a clade over fewer than
+// BitVectorFixed::sparse_min_bits taxa into a flat buffer, unless a hash
+// table over the buffer shows they are already there, so a clade that gene
+// trees repeat costs a probe rather than a slot in the sort, and memory
+// follows the number of distinct clades rather than of insertions. Wider
+// clades are buffered as they come and merged into the set once they
+// outnumber it. Sorting is an MSD radix sort over the bytes of the words
+// that skips bytes a whole bucket shares. Lookups search an Eytzinger
+// (breadth-first) copy of the sort order, which keeps the first levels of
+// every search in the same few cache lines; when all clades are of one
+// narrow size the copy holds their words, so a search compares flat words
+// rather than Clades. Clades are in the order of Clade::operator<.
+//
+// Over fewer than sparse_min_bits taxa this collects and looks up the
+// repeated clades of gene trees faster than std::unordered_set<Clade> (see
+// bench/clade_dedup.cpp). Wider clades go through Clade comparisons at
+// every step, and a hash set suits them better.
+class CladeSet {
+ public:
+  explicit CladeSet(const TaxonSet &ts);
+  CladeSet(const TaxonSet &ts, const std::unordered_set<Clade> &clades);
+
+  void insert(const Clade &clade);
+  // Sorts and deduplicates the clades and rebuilds the search layout.
+  void build();
+  // Whether build() has run since the last insert().
+  bool built() const;
+
+  // These see only the clades sorted so far, which after build() are all of
+  // them. Before build(), find() falls back to a binary search.
+  //
+  // Index of clade in the sorted order, or -1.
+  int find(const Clade &clade) const;
+  bool contains(const Clade &clade) const { return find(clade) >= 0; }
+  size_t size() const { return clades.size(); }
+  const Clade &operator[](size_t i) const { return clades[i]; }
+  std::vector<Clade>::const_iterator begin() const { return clades.begin(); }
+  std::vector<Clade>::const_iterator end() const { return clades.end(); }
+  const TaxonSet &ts() const { return *ts_; }
+
+ private:
+  size_t pending() const;
+  // Moves row_index to the given number of slots, a power of two.
+  void index_rows(size_t slots);
+  // Sorts and deduplicates the pending clades and merges them into clades,
+  // without building the search layout.
+  void compact();
+  // Indices of the pending rows in sorted order, without duplicates.
+  std::vector<uint32_t> sorted_rows() const;
+  // Compares clade with a row like Clade::compare, using buf for its words.
+  int compare_row(const Clade &clade, const elem_type *row,
+                  elem_type *buf) const;
+  Clade row_clade(const elem_type *row) const;
+
+  const TaxonSet *ts_;
+  // Sorted and free of duplicates.
+  std::vector<Clade> clades;
+  // Words of the pending clades of rows_bits bits, a row of words per clade.
+  std::vector<elem_type> rows;
+  size_t rows_bits;
+  // An open-addressed table of the pending rows by their clades' hashes, at
+  // most half full: the low 32 bits of the hash above 1 + the index of the
+  // row, or 0 in an empty slot.
+  std::vector<uint64_t> row_index;
+  // The words of clades, a row of words per clade, while every clade has
+  // rows_bits bits; otherwise empty.
+  std::vector<elem_type> words;
+  // Pending clades too wide for rows.
+  std::vector<Clade> wide;
+  // Node k of the implicit search tree (1-based; children 2k and 2k + 1)
+  // holds the index of a clade.
+  std::vector<uint32_t> eytzinger;
+  // The words of the clade of node k at k * words_for(rows_bits), when
+  // words holds those of every clade; otherwise empty.
+  std::vector<elem_type> keys;
+};
+
+#endif  // CLADESET_HPP__
@@ -0,0 +1,43 @@
+#include "CladeView.hpp"
+
+#include "BitSimd.hpp"
+#include "Clade.hpp"
+
+int CladeView::size() const {
+  return dispatch_words<word_kernels::Popcount>(nwords_, words_);
+}
+
+bool CladeView::contains(const CladeView &other) const {
+  return dispatch_words<word_kernels::IsSubset>(nwords_, other.words_, words_);
+}
+
+bool CladeView::disjoint(const CladeView &other) const {
+  return !dispatch_words<word_kernels::Intersects>(nwords_, words_,
+                                                   other.words_);
+}
+
+int CladeView::overlap_size(const CladeView &other) const {
+  return dispatch_words<word_kernels::OverlapSize>(nwords_, words_,
+                                                   other.words_);
+}
+
+SetRelation CladeView::relation(const CladeView &other) const {
+  return dispatch_words<word_kernels::Relation>(nwords_, words_, other.words_);
+}
+
+bool CladeView::operator==(const CladeView &other) const {
+  return nwords_ == other.nwords_ &&
+         dispatch_words<word_kernels::Equal>(nwords_, words_, other.words_);
+}
+
+size_t CladeView::hash() const {
+  return dispatch_words<word_kernels::Hash>(nwords_, words_);
+}
+
+Clade CladeView::to_clade(const TaxonSet &ts, CladeArena *arena) const {
+  Clade c(ts, arena);
+  for (Taxon t : *this) {
+    c.add(t);
+  }
+  return c;
+}
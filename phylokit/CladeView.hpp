@@ -0,0 +1,65 @@
+#ifndef CLADEVIEW_HPP__
+#define CLADEVIEW_HPP__
+
+#include <cstdlib>
+#include <functional>
+
+#include "BitVector.hpp"
+#include "BitWords.hpp"
+#include "TaxonSet.hpp"
+
+class Clade;
+
+// A read-only handle on a clade whose words live in a container, such as a
+// row of a BitMatrix: a pointer and a word count, with no taxon set, arena or
+// cached hash. Algorithms that only compare and count clades can run on views
+// and leave it to the container, which knows the taxon set, to materialize a
+// full Clade where one is handed out. Views compared with each other must
+// come from containers over the same taxon set, and so have as many words.
+class CladeView {
+ public:
+  CladeView() : words_(NULL), nwords_(0) {}
+  CladeView(const elem_type *words, size_t nwords)
+      : words_(words), nwords_(nwords) {}
+
+  const elem_type *words() const { return words_; }
+  size_t nwords() const { return nwords_; }
+
+  bool contains(Taxon t) const {
+    return (words_[t / (8 * sizeof(elem_type))] >>
+            (t % (8 * sizeof(elem_type)))) & 1;
+  }
+  int size() const;
+  // Whether other is a subset of this clade.
+  bool contains(const CladeView &other) const;
+  bool disjoint(const CladeView &other) const;
+  int overlap_size(const CladeView &other) const;
+  SetRelation relation(const CladeView &other) const;
+
+  bool operator==(const CladeView &other) const;
+  bool operator!=(const CladeView &other) const { return !(*this == other); }
+  // The same value as Clade::hash for the same taxa, whatever the padding.
+  size_t hash() const;
+
+  BVFIterator begin() const {
+    return nwords_ ? BVFIterator(words_, nwords_) : BVFIterator();
+  }
+  BVFIterator end() const { return BVFIterator(); }
+
+  Clade to_clade(const TaxonSet &ts, CladeArena *arena = NULL) const;
+
+ private:
+  const elem_type *words_;
+  size_t nwords_;
+};
+
+namespace std {
+template<>
+struct hash<CladeView> {
+  size_t operator()(const CladeView &view) const {
+    return view.hash();
+  }
+};
+}
+
+#endif  // CLADEVIEW_HPP__
@@ -2,6 +2,7 @@
 #include <queue>
 #include <sstream>
 #include <glog/logging.h>
+#include <utility>
 #include <vector>
 
 #include <boost/tokenizer.hpp>
@@ -104,7 +105,19 @@ double DistanceMatrix::get(Taxon t1, Taxon t2, const std::vector<double> &myD) c
   return myD[(b * (b + 1)) / 2 + a];
 };
 
-std::unordered_set<Clade> DistanceMatrix::upgma() {
+void DistanceMatrix::renumber(const std::vector<Taxon> &order) {
+  std::vector<double> new_d(d.size(), 0), new_mask(mask_.size(), 0);
+  for (Taxon b = 0; b < (Taxon) order.size(); b++) {
+    for (Taxon a = 0; a <= b; a++) {
+      get(order[a], order[b], new_d) = get(a, b, d);
+      get(order[a], order[b], new_mask) = get(a, b, mask_);
+    }
+  }
+  d.swap(new_d);
+  mask_.swap(new_mask);
+}
+
+std::unordered_set<Clade> DistanceMatrix::upgma(CladeArena *arena) {
   DLOG(INFO) << "Running UPGMA\n";
   std::vector<double> myD(d);
   std::vector<double> myMask(mask_);
@@ -116,9 +129,9 @@ std::unordered_set<Clade> DistanceMatrix::upgma() {
                       std::greater<std::tuple<double, Taxon, Taxon, int, int>>> pq;
 
   for (Taxon t1 : ts->taxa_bs) {
-    Clade c(*ts);
+    Clade c(*ts, arena);
     c.add(t1);
-    clades.insert(c);
+    clades.insert(std::move(c));
     for (Taxon t2 : ts->taxa_bs) {
       if (t1 < t2 && !isMasked(t1, t2))
         pq.push(std::make_tuple(get(t1, t2), t1, t2, 1, 1));
@@ -140,7 +153,7 @@ std::unordered_set<Clade> DistanceMatrix::upgma() {
 
     sets.merge(t1, t2);
 
-    clades.insert(sets.clade[sets.find(t1)]);
+    clades.insert(sets.clade(sets.find(t1)).to_clade(*ts, arena));
 
     for (Taxon t : *ts) {
       if (sets.find(t) == t && !masked(t, sets.find(t1))) {
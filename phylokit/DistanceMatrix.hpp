@@ -6,6 +6,7 @@
 #include <vector>
 #include <ostream>
 #include "Clade.hpp"
+#include "CladeView.hpp"
 #include "TaxonSet.hpp"
 
 class DistanceMatrix {
@@ -58,23 +59,36 @@ class DistanceMatrix {
     return *this;
   }
 
+  // Moves the entries of each taxon t to order[t], after
+  // TaxonSet::renumber.
+  void renumber(const std::vector<Taxon> &order);
+
   std::string str();
   std::ostream& writePhylip(std::ostream& out);
 
-  std::unordered_set<Clade> upgma();
+  // The clades of the UPGMA tree. With an arena, their bitsets are
+  // allocated from it.
+  std::unordered_set<Clade> upgma(CladeArena *arena = NULL);
 };
 
+// The clusters are kept as rows of one flat array and handed out as views;
+// upgma only turns the finished ones into Clades.
 struct DisjointSet {
   std::vector<int> parent;
   std::vector<int> rank;
   std::vector<int> size;
-  std::vector<Clade> clade;
+  // Words per row.
+  size_t stride;
+  std::vector<elem_type> rows;
   DisjointSet(int n, const TaxonSet &ts)
-      : parent(n), rank(n, 1), size(n, 1), clade(n, ts) {
+      : parent(n), rank(n, 1), size(n, 1),
+        stride(fixed_words_for((ts.size() + 8 * sizeof(elem_type) - 1) /
+                               (8 * sizeof(elem_type)))),
+        rows(n * stride, 0) {
     for (int i = 0; i < n; i++) {
       parent[i] = i;
-
-      clade[i].add(i);
+      rows[i * stride + i / (8 * sizeof(elem_type))] |=
+          (elem_type) 1 << (i % (8 * sizeof(elem_type)));
     }
   }
   int find(int x) {
@@ -84,6 +98,8 @@ struct DisjointSet {
     }
     return x;
   }
+  // The taxa of the set rooted at x.
+  CladeView clade(int x) const { return CladeView(&rows[x * stride], stride); }
 
   void merge(int x, int y) {
     x = find(x);
@@ -100,8 +116,11 @@ struct DisjointSet {
       rank[x]++;
       size[x] += size[y];
     };
-    clade[x] = clade[x] + clade[y];
-    clade[y] = clade[x];
+    int root = parent[x] == x ? x : y;
+    int other = root == x ? y : x;
+    for (size_t w = 0; w < stride; w++) {
+      rows[root * stride + w] |= rows[other * stride + w];
+    }
   }
 };
 
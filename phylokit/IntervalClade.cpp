@@ -0,0 +1,41 @@
+#include "IntervalClade.hpp"
+
+#include "TreeClade.hpp"
+
+// A preorder walk numbers the leaves as it meets them, which gives each node
+// the start of its interval; a node then ends where its last child does,
+// filled in children first by going through the preorder backwards.
+TreeIntervals::TreeIntervals(const Tree &tree)
+    : ts(&tree.ts), intervals(tree.size()), positions(tree.ts.size(), -1) {
+  std::vector<int> preorder, stack;
+  stack.push_back(0);
+  while (stack.size()) {
+    int n = stack.back();
+    stack.pop_back();
+    preorder.push_back(n);
+    intervals[n].lo = order.size();
+    if (tree.is_leaf(n)) {
+      positions[tree.taxon(n)] = order.size();
+      order.push_back(tree.taxon(n));
+      continue;
+    }
+    size_t first = stack.size();
+    for (int c : tree.children(n)) {
+      stack.push_back(c);
+    }
+    std::reverse(stack.begin() + first, stack.end());
+  }
+  for (size_t i = preorder.size(); i-- > 0;) {
+    int n = preorder[i];
+    intervals[n].hi =
+        tree.is_leaf(n) ? intervals[n].lo : intervals[tree.last_child(n)].hi;
+  }
+}
+
+Clade TreeIntervals::to_clade(const IntervalClade &c, CladeArena *arena) const {
+  Clade clade(*ts, arena);
+  for (int p = c.lo; p <= c.hi; p++) {
+    clade.add(order[p]);
+  }
+  return clade;
+}
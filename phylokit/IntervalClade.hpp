@@ -0,0 +1,86 @@
+#ifndef INTERVALCLADE_HPP__
+#define INTERVALCLADE_HPP__
+
+#include <algorithm>
+#include <vector>
+
+#include "BitWords.hpp"
+#include "Clade.hpp"
+
+class Tree;
+
+// A clade of a tree as the range [lo, hi] of positions its leaves take in the
+// tree's left-to-right leaf order, which every clade of the tree occupies
+// contiguously. Two ints instead of a bit vector, and containment, overlap
+// and equality between clades of the same tree in O(1). Positions only mean
+// something within one TreeIntervals, which turns them back into taxa.
+struct IntervalClade {
+  int lo, hi;
+
+  IntervalClade() : lo(0), hi(-1) {}
+  IntervalClade(int lo, int hi) : lo(lo), hi(hi) {}
+
+  int size() const { return hi - lo + 1; }
+  bool empty() const { return hi < lo; }
+  bool contains(int position) const { return lo <= position && position <= hi; }
+  bool contains(const IntervalClade &other) const {
+    return other.empty() || (lo <= other.lo && other.hi <= hi);
+  }
+  int overlap_size(const IntervalClade &other) const {
+    return std::max(0, std::min(hi, other.hi) - std::max(lo, other.lo) + 1);
+  }
+  bool disjoint(const IntervalClade &other) const {
+    return overlap_size(other) == 0;
+  }
+  SetRelation relation(const IntervalClade &other) const {
+    if (*this == other) return EQUAL;
+    if (other.contains(*this)) return SUBSET;
+    if (contains(other)) return SUPERSET;
+    return disjoint(other) ? DISJOINT : CROSSING;
+  }
+
+  bool operator==(const IntervalClade &other) const {
+    return (lo == other.lo && hi == other.hi) || (empty() && other.empty());
+  }
+  bool operator!=(const IntervalClade &other) const {
+    return !(*this == other);
+  }
+};
+
+// The leaf order of a tree, as in Tree::leaf_order, and the interval of each
+// of its nodes: O(n) for the whole tree, against a bit vector per node for
+// its TreeClades. Bit vectors are only built, by to_clade, for comparing with
+// clades from elsewhere. After ts.renumber(tree.leaf_order()), positions and
+// taxa coincide. The tree's shape must not change while this is in use.
+class TreeIntervals {
+ public:
+  explicit TreeIntervals(const Tree &tree);
+
+  // Indexed by node, like Tree::node.
+  const IntervalClade &operator[](int node) const { return intervals[node]; }
+  const IntervalClade &root() const { return intervals[0]; }
+
+  // The taxon at a position and the position of a taxon, -1 for taxa not in
+  // the tree.
+  Taxon taxon(int position) const { return order[position]; }
+  int position(Taxon t) const {
+    return (size_t) t < positions.size() ? positions[t] : -1;
+  }
+  const std::vector<Taxon> &leaf_order() const { return order; }
+
+  bool contains(int node, Taxon t) const {
+    return intervals[node].contains(position(t));
+  }
+  Clade to_clade(const IntervalClade &c, CladeArena *arena = NULL) const;
+  Clade to_clade(int node, CladeArena *arena = NULL) const {
+    return to_clade(intervals[node], arena);
+  }
+
+ private:
+  const TaxonSet *ts;
+  std::vector<IntervalClade> intervals;
+  std::vector<Taxon> order;
+  std::vector<int> positions;
+};
+
+#endif  // INTERVALCLADE_HPP__
@@ -0,0 +1,85 @@
+#include "RankSelect.hpp"
+
+#include <algorithm>
+
+RankSelect::RankSelect(const BitVectorFixed &bits)
+    : words(bits.data),
+      nwords((bits.size + 8 * sizeof(elem_type) - 1) / (8 * sizeof(elem_type))),
+      members(bits.members),
+      nmembers(bits.count),
+      total(0) {
+  if (members) {
+    total = nmembers;
+    return;
+  }
+  size_t nblocks = (nwords + block_words - 1) / block_words;
+  blocks.resize(2 * nblocks);
+  for (size_t b = 0; b < nblocks; b++) {
+    blocks[2 * b] = total;
+    uint64_t packed = 0;
+    int in_block = 0;
+    for (size_t j = 0; j < block_words && b * block_words + j < nwords; j++) {
+      if (j) {
+        packed |= (uint64_t) in_block << (9 * (j - 1));
+      }
+      in_block += popcount_word(words[b * block_words + j]);
+      while (samples.size() * select_sample < (size_t) (total + in_block)) {
+        samples.push_back(b);
+      }
+    }
+    blocks[2 * b + 1] = packed;
+    total += in_block;
+  }
+}
+
+int RankSelect::rank(size_t i) const {
+  if (members) {
+    return std::lower_bound(members, members + nmembers, i) - members;
+  }
+  size_t w = i / (8 * sizeof(elem_type));
+  if (w >= nwords) {
+    return total;
+  }
+  size_t b = w / block_words, j = w % block_words;
+  int ans = blocks[2 * b];
+  if (j) {
+    ans += (blocks[2 * b + 1] >> (9 * (j - 1))) & 511;
+  }
+  elem_type below = ((elem_type) 1 << (i % (8 * sizeof(elem_type)))) - 1;
+  return ans + popcount_word(words[w] & below);
+}
+
+int RankSelect::select(size_t k) const {
+  if (k >= (size_t) total) {
+    return -1;
+  }
+  if (members) {
+    return members[k];
+  }
+  // The last block starting at or before set bit k.
+  size_t s = k / select_sample;
+  size_t lo = samples[s];
+  size_t hi = s + 1 < samples.size() ? samples[s + 1] + 1 : blocks.size() / 2;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (blocks[2 * mid] <= k) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  size_t rest = k - blocks[2 * lo];
+  size_t j = 0;
+  while (j + 1 < block_words && lo * block_words + j + 1 < nwords &&
+         ((blocks[2 * lo + 1] >> (9 * j)) & 511) <= rest) {
+    j++;
+  }
+  if (j) {
+    rest -= (blocks[2 * lo + 1] >> (9 * (j - 1))) & 511;
+  }
+  elem_type w = words[lo * block_words + j];
+  for (; rest; rest--) {
+    w &= w - 1;
+  }
+  return (lo * block_words + j) * 8 * sizeof(elem_type) + lowest_bit(w);
+}
@@ -0,0 +1,41 @@
+#ifndef RANKSELECT_HPP__
+#define RANKSELECT_HPP__
+
+#include <vector>
+
+#include "BitVector.hpp"
+
+// Rank and select directory for a BitVectorFixed. For every block of eight
+// words it stores the number of set bits before the block and, packed into
+// one word as 9-bit fields, the number before each word inside it, so
+// rank(i) is two lookups and one popcount. select(k) starts from a sample
+// of the block holding every 512th set bit and bisects from there. Sparse
+// bit vectors answer from their member array and need no directory. The
+// bit vector must outlive the directory and not change while it is in use.
+class RankSelect {
+ public:
+  explicit RankSelect(const BitVectorFixed &bits);
+
+  // Number of set bits before position i, for i up to the size of the bit
+  // vector.
+  int rank(size_t i) const;
+  // Position of the set bit with rank k, or -1 if there are at most k.
+  int select(size_t k) const;
+  int count() const { return total; }
+
+ private:
+  static const size_t block_words = 8;
+  static const size_t select_sample = 512;
+
+  const elem_type *words;
+  size_t nwords;
+  const uint32_t *members;
+  size_t nmembers;
+  // Two entries per block: set bits before it, and the packed counts.
+  std::vector<uint64_t> blocks;
+  // Block holding set bit k * select_sample.
+  std::vector<uint32_t> samples;
+  int total;
+};
+
+#endif  // RANKSELECT_HPP__
@@ -0,0 +1,130 @@
+#ifndef SPARSEBITS_HPP__
+#define SPARSEBITS_HPP__
+
+#include <algorithm>
+
+#include "BitWords.hpp"
+
+// Kernels for sets stored as sorted arrays of member indices, the sparse form
+// of a BitVectorFixed. Operations on two arrays of very different lengths
+// gallop through the longer one, so their cost grows with the shorter array
+// times the log of the longer one rather than with the sum of both.
+
+// Below this length ratio a linear merge beats galloping.
+const size_t gallop_ratio = 16;
+
+// Position of the first element of a[lo, n) that is not less than x, found by
+// doubling the step from lo and then bisecting, so finding an element k places
+// ahead costs O(log k).
+inline size_t gallop(const uint32_t *a, size_t lo, size_t n, uint32_t x) {
+  size_t step = 1, hi = lo;
+  while (hi < n && a[hi] < x) {
+    lo = hi + 1;
+    hi += step;
+    step *= 2;
+  }
+  return std::lower_bound(a + lo, a + std::min(hi, n), x) - a;
+}
+
+inline bool sorted_contains(const uint32_t *a, size_t n, uint32_t x) {
+  return std::binary_search(a, a + n, x);
+}
+
+inline bool words_contain(const elem_type *words, uint32_t x) {
+  return (words[x / (8 * sizeof(elem_type))] >> (x % (8 * sizeof(elem_type)))) & 1;
+}
+
+inline size_t sorted_overlap_size(const uint32_t *a, size_t na,
+                                  const uint32_t *b, size_t nb) {
+  if (na > nb) {
+    std::swap(a, b);
+    std::swap(na, nb);
+  }
+  size_t ans = 0;
+  if (na * gallop_ratio < nb) {
+    size_t j = 0;
+    for (size_t i = 0; i < na && j < nb; i++) {
+      j = gallop(b, j, nb, a[i]);
+      ans += j < nb && b[j] == a[i];
+    }
+    return ans;
+  }
+  size_t i = 0, j = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      i++;
+    } else if (b[j] < a[i]) {
+      j++;
+    } else {
+      ans++;
+      i++;
+      j++;
+    }
+  }
+  return ans;
+}
+
+inline size_t sorted_words_overlap_size(const uint32_t *a, size_t na,
+                                        const elem_type *words) {
+  size_t ans = 0;
+  for (size_t i = 0; i < na; i++) {
+    ans += words_contain(words, a[i]);
+  }
+  return ans;
+}
+
+inline bool sorted_is_subset(const uint32_t *a, size_t na, const uint32_t *b,
+                             size_t nb) {
+  if (na > nb) {
+    return false;
+  }
+  size_t j = 0;
+  for (size_t i = 0; i < na; i++) {
+    j = gallop(b, j, nb, a[i]);
+    if (j == nb || b[j] != a[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Keeps the elements of a that are (or, with keep false, are not) members of
+// the sorted array b, compacting them to the front of a. Returns how many
+// are left.
+inline size_t sorted_filter(uint32_t *a, size_t na, const uint32_t *b,
+                            size_t nb, bool keep) {
+  size_t out = 0, j = 0;
+  for (size_t i = 0; i < na; i++) {
+    j = gallop(b, j, nb, a[i]);
+    if ((j < nb && b[j] == a[i]) == keep) {
+      a[out++] = a[i];
+    }
+  }
+  return out;
+}
+
+// As sorted_filter, testing membership in a word array.
+inline size_t sorted_words_filter(uint32_t *a, size_t na,
+                                  const elem_type *words, bool keep) {
+  size_t out = 0;
+  for (size_t i = 0; i < na; i++) {
+    if (words_contain(words, a[i]) == keep) {
+      a[out++] = a[i];
+    }
+  }
+  return out;
+}
+
+// The relation of sets A and B given |A & B|, |A - B| and |B - A|.
+inline SetRelation relation_from_counts(size_t both, size_t a_only,
+                                        size_t b_only) {
+  if (!a_only) {
+    return b_only ? SUBSET : EQUAL;
+  }
+  if (!b_only) {
+    return SUPERSET;
+  }
+  return both ? CROSSING : DISJOINT;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "TaxonCounter.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const size_t bits_per_word = 8 * sizeof(elem_type);
+
+}  // namespace
+
+TaxonCounter::TaxonCounter(size_t size)
+    : size_(size),
+      nwords((size + bits_per_word - 1) / bits_per_word),
+      n(0),
+      nplanes(0),
+      sums(csa_levels * nwords, 0),
+      pending(csa_levels * nwords, 0),
+      scratch(nwords, 0) {
+  std::fill(has_pending, has_pending + csa_levels, false);
+}
+
+TaxonCounter::TaxonCounter(const TaxonSet &ts) : TaxonCounter(ts.size()) {}
+
+void TaxonCounter::add(const BitVectorFixed &bits) {
+  n++;
+  // Counts never exceed n, so the planes only need its bits.
+  while (((size_t) 1 << nplanes) <= n) {
+    planes.resize(++nplanes * nwords, 0);
+  }
+  if (bits.is_sparse()) {
+    if (direct.empty()) {
+      direct.resize(size_, 0);
+    }
+    for (Taxon t : bits) {
+      direct[t]++;
+    }
+    return;
+  }
+  size_t words = (bits.size + bits_per_word - 1) / bits_per_word;
+  if (scratch.size() < words) {
+    scratch.resize(words);
+  }
+  bits.copy_words(scratch.data());
+  std::fill(scratch.begin() + std::min(words, nwords),
+            scratch.begin() + nwords, 0);
+  carry(0, scratch.data());
+}
+
+void TaxonCounter::carry(int level, elem_type *in) {
+  if (level == csa_levels) {
+    ripple(csa_levels, in);
+    return;
+  }
+  elem_type *p = &pending[level * nwords];
+  if (!has_pending[level]) {
+    std::copy(in, in + nwords, p);
+    has_pending[level] = true;
+    return;
+  }
+  // A carry-save adder: sums + p + in = sums' + 2 * carry, bitwise.
+  elem_type *s = &sums[level * nwords];
+  for (size_t w = 0; w < nwords; w++) {
+    elem_type u = s[w] ^ p[w];
+    elem_type c = (s[w] & p[w]) | (u & in[w]);
+    s[w] = u ^ in[w];
+    in[w] = c;
+  }
+  has_pending[level] = false;
+  carry(level + 1, in);
+}
+
+void TaxonCounter::ripple(size_t k0, const elem_type *in) {
+  for (size_t w = 0; w < nwords; w++) {
+    elem_type c = in[w];
+    for (size_t k = k0; c; k++) {
+      elem_type &p = plane(k)[w];
+      elem_type next = p & c;
+      p ^= c;
+      c = next;
+    }
+  }
+}
+
+std::vector<uint32_t> TaxonCounter::counts() const {
+  std::vector<uint32_t> ans(direct);
+  ans.resize(size_, 0);
+  auto add_words = [&](const elem_type *words, uint32_t weight) {
+    for (size_t w = 0; w < nwords; w++) {
+      for (elem_type rest = words[w]; rest; rest &= rest - 1) {
+        ans[w * bits_per_word + lowest_bit(rest)] += weight;
+      }
+    }
+  };
+  for (int level = 0; level < csa_levels; level++) {
+    add_words(&sums[level * nwords], 1u << level);
+    if (has_pending[level]) {
+      add_words(&pending[level * nwords], 1u << level);
+    }
+  }
+  for (size_t k = 0; k < nplanes; k++) {
+    add_words(&planes[k * nwords], 1u << k);
+  }
+  return ans;
+}
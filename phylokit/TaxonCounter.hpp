@@ -0,0 +1,56 @@
+#ifndef TAXONCOUNTER_HPP__
+#define TAXONCOUNTER_HPP__
+
+#include <vector>
+
+#include "BitVector.hpp"
+#include "Clade.hpp"
+
+// Counts, for every taxon, how many of the added bit vectors contain it.
+// Counts are kept bit-sliced: plane k holds bit k of every taxon's count, so
+// adding a bit vector is a few word operations per word instead of one
+// increment per member. Added vectors first go through a cascade of
+// carry-save adders, one per weight 1, 2, 4 and 8, that only combines
+// words; what overflows the cascade is rippled into the planes a sixteenth
+// as often. Sparse bit vectors, whose words are nearly all zero, are
+// counted member by member in a plain array instead.
+class TaxonCounter {
+ public:
+  explicit TaxonCounter(size_t size);
+  explicit TaxonCounter(const TaxonSet &ts);
+
+  // bits may have at most size() bits.
+  void add(const BitVectorFixed &bits);
+  void add(const Clade &clade) { add(clade.get_taxa()); }
+
+  size_t size() const { return size_; }
+  // The number of bit vectors added.
+  size_t added() const { return n; }
+  // Element t is the number of added bit vectors holding bit t.
+  std::vector<uint32_t> counts() const;
+
+ private:
+  static const int csa_levels = 4;
+
+  // Adds the words in in, each bit of weight 2^level, using in as scratch.
+  void carry(int level, elem_type *in);
+  // Adds the words in in to the planes, each bit of weight 2^plane.
+  void ripple(size_t plane, const elem_type *in);
+  elem_type *plane(size_t k) { return &planes[k * nwords]; }
+
+  size_t size_;
+  size_t nwords;
+  size_t n;
+  size_t nplanes;
+  // Per cascade level, the sum bits and an input waiting for a partner.
+  std::vector<elem_type> sums;
+  std::vector<elem_type> pending;
+  bool has_pending[csa_levels];
+  // nplanes planes, plane-major, nwords words per plane.
+  std::vector<elem_type> planes;
+  std::vector<elem_type> scratch;
+  // Counts from sparse bit vectors, allocated on first use.
+  std::vector<uint32_t> direct;
+};
+
+#endif  // TAXONCOUNTER_HPP__
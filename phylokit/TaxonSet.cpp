@@ -1,44 +1,244 @@
 #include "TaxonSet.hpp"
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/tokenizer.hpp>
 
 #define strtok_r strtok_s
-TaxonSet::TaxonSet(int size) : frozen(false), taxa_bs(size) {}
+
+namespace {
+
+// Names are short, so the arena's slabs are small too.
+const size_t name_slab_bytes = 16 * 1024;
+
+uint64_t name_hash(const char *s, size_t n) {
+  uint64_t h = hash_seed ^ (n * 0x9e3779b97f4a7c15ULL);
+  for (; n >= 8; s += 8, n -= 8) {
+    uint64_t w;
+    memcpy(&w, s, 8);
+    h = mix64(h ^ w);
+  }
+  uint64_t w = 0;
+  memcpy(&w, s, n);
+  return mix64(h ^ w);
+}
+
+size_t pow2_at_least(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p *= 2;
+  }
+  return p;
+}
+
+// The bucket and slot of a name with hash h in a frozen set, the slot for
+// displacement d of its bucket. Names in one bucket differ in the low or the
+// high half of their hashes, so some displacement separates them.
+size_t frozen_bucket(uint64_t h, size_t nbuckets) {
+  return (h >> 20) & (nbuckets - 1);
+}
+size_t frozen_slot(uint64_t h, uint32_t d, size_t mask) {
+  return (h + d * ((h >> 32) | 1)) & mask;
+}
+
+TaxonName copy_name(CladeArena &arena, const char *name, size_t n) {
+  char *copy = static_cast<char *>(arena.allocate(n + 1));
+  memcpy(copy, name, n);
+  copy[n] = '\0';
+  return TaxonName(copy, n);
+}
+
+// The first eight bytes of name as a big-endian number, padded with zeros,
+// which orders names like their bytes do as far as it goes.
+uint64_t name_prefix(const TaxonName &name) {
+  uint64_t key = 0;
+  size_t n = std::min<size_t>(name.size(), 8);
+  for (size_t i = 0; i < n; i++) {
+    key |= (uint64_t) (unsigned char) name.data()[i] << (56 - 8 * i);
+  }
+  return key;
+}
+
+// Puts taxon t, whose name hashes to h, in the first empty slot from h on.
+void place(std::vector<Taxon> &table, Taxon t, uint64_t h) {
+  size_t mask = table.size() - 1;
+  size_t i = h & mask;
+  while (table[i] >= 0) {
+    i = (i + 1) & mask;
+  }
+  table[i] = t;
+}
+
+// Doubles table, placing its taxa by their hashes.
+void grow(std::vector<Taxon> &table, const std::vector<uint64_t> &hashes) {
+  std::vector<Taxon> old(2 * table.size(), -1);
+  old.swap(table);
+  for (Taxon t : old) {
+    if (t >= 0) {
+      place(table, t, hashes[t]);
+    }
+  }
+}
+
+}  // namespace
+
+// The names of a concurrent set, sharded by the top bits of their hashes.
+// Each shard numbers its names in a table like the set's own, and copies
+// them into its own arena, under its lock. The taxa's names and hashes are
+// written to the set's vectors, which make_concurrent() sizes for as many
+// taxa as the set can hold, at the numbers the counter hands out, so no two
+// threads write the same entry and the vectors never move.
+struct TaxonSet::Shared {
+  static const int shard_bits = 6;
+
+  struct Shard {
+    Shard() : arena(name_slab_bytes >> shard_bits), count(0) {}
+    std::mutex lock;
+    CladeArena arena;
+    std::vector<Taxon> slots;
+    size_t count;
+  };
+
+  Shard &shard(uint64_t h) { return shards[h >> (64 - shard_bits)]; }
+
+  Shard shards[1 << shard_bits];
+  std::atomic<size_t> next;
+  size_t base;
+};
+
+TaxonSet::TaxonSet(int size)
+    : arena(new CladeArena(name_slab_bytes)),
+      slots(pow2_at_least(std::max(2 * size, 16)), -1),
+      frozen(false),
+      concurrent(false),
+      taxa_bs(size) {
+  names.reserve(size);
+  hashes.reserve(size);
+}
 
 TaxonSet::TaxonSet(std::string str)
-    : frozen(false), taxa_bs(resize_clades(str)) {
-  taxa.reserve(taxa_set.size());
+    : arena(new CladeArena(name_slab_bytes)),
+      frozen(false),
+      concurrent(false),
+      taxa_bs(0) {
+  std::unordered_set<std::string> taxa_set;
+  std::stringstream stream(str);
+  std::string s;
+  while (!stream.eof()) {
+    std::getline(stream, s);
+    if (s.size() == 0) continue;
+    add_clade_taxa(s, taxa_set);
+  }
+  taxa_bs = clade_bitset(taxa_set.size());
+  slots.assign(pow2_at_least(std::max<size_t>(2 * taxa_set.size(), 16)), -1);
+  names.reserve(taxa_set.size());
+  hashes.reserve(taxa_set.size());
 
   for (const std::string &i : taxa_set) {
     add(i);
   }
 }
 
-TaxonSet::TaxonSet(const TaxonSet &&other)
-    : taxa_set(other.taxa_set),
-      taxa(other.taxa),
-      index(other.index),
+TaxonSet::TaxonSet(TaxonSet &&other)
+    : arena(std::move(other.arena)),
+      names(std::move(other.names)),
+      hashes(std::move(other.hashes)),
+      slots(std::move(other.slots)),
+      displace(std::move(other.displace)),
+      shared(std::move(other.shared)),
       frozen(other.frozen),
-      taxa_bs(other.taxa_bs) {}
-TaxonSet &TaxonSet::operator=(const TaxonSet &&other) {
+      concurrent(other.concurrent),
+      taxa_bs(std::move(other.taxa_bs)) {}
+TaxonSet &TaxonSet::operator=(TaxonSet &&other) {
   if (this == &other) {
     return *this;
   }
-  taxa_set = other.taxa_set;
-  taxa = other.taxa;
-  index = other.index;
+  arena = std::move(other.arena);
+  names = std::move(other.names);
+  hashes = std::move(other.hashes);
+  slots = std::move(other.slots);
+  displace = std::move(other.displace);
+  shared = std::move(other.shared);
   frozen = other.frozen;
-  taxa_bs = other.taxa_bs;
+  concurrent = other.concurrent;
+  taxa_bs = std::move(other.taxa_bs);
   return *this;
 }
 
-void TaxonSet::freeze() { frozen = true; }
+TaxonSet::~TaxonSet() {}
+
+// Hash and displace: the names are split into buckets of about four by hash,
+// and the buckets, largest first, are each given the first displacement that
+// moves all their names to free slots. A table a quarter larger than the
+// number of names leaves enough room that this takes a few tries per bucket;
+// should a bucket run out of displacements, the table doubles and starts
+// over.
+void TaxonSet::freeze() {
+  assert(!concurrent);
+  frozen = true;
+  size_t n = names.size();
+  size_t nbuckets = pow2_at_least(std::max<size_t>(n / 4, 1));
+  std::vector<std::vector<Taxon>> buckets(nbuckets);
+  for (size_t t = 0; t < n; t++) {
+    buckets[frozen_bucket(hashes[t], nbuckets)].push_back(t);
+  }
+  std::vector<size_t> order(nbuckets);
+  for (size_t b = 0; b < nbuckets; b++) {
+    order[b] = b;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  const uint32_t max_displace = 1 << 16;
+  std::vector<size_t> placed;
+  for (size_t m = pow2_at_least(n + n / 4 + 1);; m *= 2) {
+    slots.assign(m, -1);
+    displace.assign(nbuckets, 0);
+    bool done = true;
+    for (size_t b : order) {
+      const std::vector<Taxon> &bucket = buckets[b];
+      if (bucket.empty()) {
+        break;
+      }
+      uint32_t d = 0;
+      for (; d < max_displace; d++) {
+        placed.clear();
+        for (Taxon t : bucket) {
+          size_t slot = frozen_slot(hashes[t], d, m - 1);
+          if (slots[slot] >= 0 ||
+              std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+            break;
+          }
+          placed.push_back(slot);
+        }
+        if (placed.size() == bucket.size()) {
+          break;
+        }
+      }
+      if (d == max_displace) {
+        done = false;
+        break;
+      }
+      displace[b] = d;
+      for (size_t i = 0; i < bucket.size(); i++) {
+        slots[placed[i]] = bucket[i];
+      }
+    }
+    if (done) {
+      return;
+    }
+  }
+}
 
 int TaxonSet::resize_clades(std::string str) {
+  std::unordered_set<std::string> taxa_set;
   std::stringstream stream(str);
   std::string s;
 
@@ -61,24 +261,216 @@ void TaxonSet::add_clade_taxa(std::string str,
   }
 }
 
-Taxon TaxonSet::add(const std::string &str) {
-  if (index.count(str)) {
-    return index[str];
+size_t TaxonSet::probe(const std::vector<Taxon> &table, const char *name,
+                       size_t n, uint64_t h) const {
+  size_t mask = table.size() - 1;
+  size_t i = h & mask;
+  while (table[i] >= 0 &&
+         !(hashes[table[i]] == h && names[table[i]].equals(name, n))) {
+    i = (i + 1) & mask;
   }
+  return i;
+}
 
+Taxon TaxonSet::find(const char *name, size_t n, uint64_t h) const {
+  if (concurrent) {
+    Shared::Shard &shard = shared->shard(h);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.slots[probe(shard.slots, name, n, h)];
+  }
   if (frozen) {
-    std::cerr << "Trying to add " << str << " to frozen taxon set\n";
-    for (const std::string &i : taxa_set) {
-      std::cerr << (i) << std::endl;
+    uint32_t d = displace[frozen_bucket(h, displace.size())];
+    Taxon t = slots[frozen_slot(h, d, slots.size() - 1)];
+    return t >= 0 && hashes[t] == h && names[t].equals(name, n) ? t : -1;
+  }
+  return slots[probe(slots, name, n, h)];
+}
+
+Taxon TaxonSet::find(const char *name, size_t n) const {
+  return find(name, n, name_hash(name, n));
+}
+
+Taxon TaxonSet::operator[](const std::string &str) const {
+  Taxon t = find(str.data(), str.size());
+  if (t < 0) {
+    throw std::out_of_range("TaxonSet: no taxon named " + str);
+  }
+  return t;
+}
+
+// Places each taxon in a table of nslots by its stored hash.
+void TaxonSet::rehash(size_t nslots) {
+  slots.assign(nslots, -1);
+  for (size_t t = 0; t < names.size(); t++) {
+    place(slots, t, hashes[t]);
+  }
+}
+
+Taxon TaxonSet::add(const char *name, size_t n) {
+  uint64_t h = name_hash(name, n);
+  if (concurrent) {
+    return add_shared(name, n, h);
+  }
+  if (frozen) {
+    Taxon found = find(name, n, h);
+    if (found >= 0) {
+      return found;
+    }
+    std::cerr << "Trying to add " << std::string(name, n)
+              << " to frozen taxon set\n";
+    for (const TaxonName &i : names) {
+      std::cerr << i << std::endl;
     }
     assert(false);
+    frozen = false;
+    displace.clear();
+    rehash(pow2_at_least(std::max<size_t>(2 * names.size(), 16)));
   }
 
-  int i = taxa.size();
-  taxa.push_back(str);
-  index[str] = i;
+  size_t slot = probe(slots, name, n, h);
+  if (slots[slot] >= 0) {
+    return slots[slot];
+  }
+  int i = names.size();
+  names.push_back(copy_name(*arena, name, n));
+  hashes.push_back(h);
+  slots[slot] = i;
+  if (2 * names.size() > slots.size()) {
+    rehash(2 * slots.size());
+  }
   taxa_bs.set(i);
   return i;
 }
 
-size_t TaxonSet::size() const { return taxa.size(); }
+Taxon TaxonSet::add_shared(const char *name, size_t n, uint64_t h) {
+  Shared::Shard &shard = shared->shard(h);
+  std::lock_guard<std::mutex> guard(shard.lock);
+  size_t slot = probe(shard.slots, name, n, h);
+  if (shard.slots[slot] >= 0) {
+    return shard.slots[slot];
+  }
+  size_t i = shared->next++;
+  if (i >= names.size()) {
+    shared->next--;
+    throw std::length_error("TaxonSet: more taxa than the set was made for");
+  }
+  names[i] = copy_name(shard.arena, name, n);
+  hashes[i] = h;
+  shard.slots[slot] = i;
+  if (2 * ++shard.count > shard.slots.size()) {
+    grow(shard.slots, hashes);
+  }
+  return i;
+}
+
+void TaxonSet::make_concurrent() {
+  assert(!frozen && !concurrent);
+  if (!shared) {
+    shared.reset(new Shared());
+  }
+  size_t base = names.size();
+  size_t capacity = std::max(base, taxa_bs.size);
+  shared->base = base;
+  shared->next = base;
+  names.resize(capacity);
+  hashes.resize(capacity);
+  size_t shard_slots = pow2_at_least(
+      std::max<size_t>(2 * (capacity >> Shared::shard_bits) + 2, 16));
+  for (Shared::Shard &shard : shared->shards) {
+    shard.slots.assign(shard_slots, -1);
+    shard.count = 0;
+  }
+  for (size_t t = 0; t < base; t++) {
+    Shared::Shard &shard = shared->shard(hashes[t]);
+    place(shard.slots, t, hashes[t]);
+    if (2 * ++shard.count > shard.slots.size()) {
+      grow(shard.slots, hashes);
+    }
+  }
+  std::vector<Taxon>().swap(slots);
+  concurrent = true;
+}
+
+std::vector<Taxon> TaxonSet::canonicalize() {
+  assert(concurrent);
+  size_t base = shared->base;
+  size_t n = shared->next;
+  // Sorted on the first eight bytes of the names, which usually decide,
+  // before comparing whole names.
+  std::vector<std::pair<uint64_t, Taxon>> keyed(n - base);
+  for (size_t i = 0; i < keyed.size(); i++) {
+    keyed[i] = std::make_pair(name_prefix(names[base + i]), base + i);
+  }
+  std::sort(keyed.begin(), keyed.end(),
+            [&](const std::pair<uint64_t, Taxon> &a,
+                const std::pair<uint64_t, Taxon> &b) {
+              return a.first != b.first ? a.first < b.first
+                                        : names[a.second] < names[b.second];
+            });
+  std::vector<Taxon> added(keyed.size());
+  for (size_t i = 0; i < keyed.size(); i++) {
+    added[i] = keyed[i].second;
+  }
+
+  std::vector<Taxon> order(n);
+  for (size_t t = 0; t < base; t++) {
+    order[t] = t;
+  }
+  std::vector<TaxonName> sorted_names(n - base);
+  std::vector<uint64_t> sorted_hashes(n - base);
+  for (size_t i = 0; i < added.size(); i++) {
+    order[added[i]] = base + i;
+    sorted_names[i] = names[added[i]];
+    sorted_hashes[i] = hashes[added[i]];
+  }
+  names.resize(n);
+  hashes.resize(n);
+  std::copy(sorted_names.begin(), sorted_names.end(), names.begin() + base);
+  std::copy(sorted_hashes.begin(), sorted_hashes.end(), hashes.begin() + base);
+
+  // The shards' arenas hold the new names; only their tables go.
+  for (Shared::Shard &shard : shared->shards) {
+    std::vector<Taxon>().swap(shard.slots);
+  }
+  concurrent = false;
+  rehash(pow2_at_least(std::max<size_t>(2 * n, 16)));
+  for (size_t t = base; t < n; t++) {
+    taxa_bs.set(t);
+  }
+  return order;
+}
+
+std::vector<Taxon> TaxonSet::renumber(const std::vector<Taxon> &first) {
+  assert(!concurrent);
+  size_t n = names.size();
+  std::vector<Taxon> order(n, -1);
+  Taxon next = 0;
+  for (Taxon t : first) {
+    if (order[t] < 0) {
+      order[t] = next++;
+    }
+  }
+  for (size_t t = 0; t < n; t++) {
+    if (order[t] < 0) {
+      order[t] = next++;
+    }
+  }
+
+  std::vector<TaxonName> old_names(names);
+  std::vector<uint64_t> old_hashes(hashes);
+  for (size_t t = 0; t < n; t++) {
+    names[order[t]] = old_names[t];
+    hashes[order[t]] = old_hashes[t];
+  }
+  if (frozen) {
+    freeze();
+  } else {
+    rehash(slots.size());
+  }
+  return order;
+}
+
+size_t TaxonSet::size() const {
+  return concurrent ? std::min<size_t>(shared->next, names.size())
+                    : names.size();
+}
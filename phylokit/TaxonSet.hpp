@@ -3,35 +3,102 @@
 
 #include <algorithm>
 #include <bitset>
-#include <unordered_map>
+#include <cstring>
+#include <memory>
+#include <ostream>
 #include <sstream>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
 #include "BitVector.hpp"
+#include "CladeArena.hpp"
 
 typedef int Taxon;
 typedef BitVectorFixed clade_bitset;
 class Clade;
 
+// A taxon's name as stored by its TaxonSet: a NUL-terminated string in the
+// set's name arena, valid for as long as the set is. Converts to std::string
+// where one is needed.
+class TaxonName {
+ public:
+  TaxonName() : data_(""), size_(0) {}
+  TaxonName(const char *data, size_t size) : data_(data), size_(size) {}
+
+  const char *data() const { return data_; }
+  const char *c_str() const { return data_; }
+  size_t size() const { return size_; }
+  std::string str() const { return std::string(data_, size_); }
+  operator std::string() const { return str(); }
+
+  bool equals(const char *s, size_t n) const {
+    return n == size_ && memcmp(data_, s, n) == 0;
+  }
+  bool operator==(const TaxonName &o) const { return equals(o.data_, o.size_); }
+  bool operator!=(const TaxonName &o) const { return !(*this == o); }
+  bool operator==(const std::string &s) const {
+    return equals(s.data(), s.size());
+  }
+  bool operator!=(const std::string &s) const { return !(*this == s); }
+  bool operator<(const TaxonName &o) const {
+    int c = memcmp(data_, o.data_, std::min(size_, o.size_));
+    return c ? c < 0 : size_ < o.size_;
+  }
+
+ private:
+  const char *data_;
+  size_t size_;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const TaxonName &name) {
+  return os.write(name.data(), name.size());
+}
+
+// Numbers taxa by name. Each name is stored once, in an arena, and found
+// through an open-addressing table of taxon numbers that keeps every name's
+// hash, so probes compare hashes before names and growing the table never
+// rehashes a name. freeze() replaces the table by a perfect hash over the
+// names added so far, after which a lookup is a single probe.
+//
+// A TaxonSet is not safe to add to from several threads unless it is made
+// concurrent; a frozen one only ever reads, so any number of threads can
+// parse against it.
 class TaxonSet {
  private:
-  std::unordered_set<std::string> taxa_set;
-  std::vector<std::string> taxa;
-  std::unordered_map<std::string, Taxon> index;
+  struct Shared;
+
+  std::unique_ptr<CladeArena> arena;
+  std::vector<TaxonName> names;
+  std::vector<uint64_t> hashes;
+  // Taxon numbers, -1 for empty slots; a power of two long.
+  std::vector<Taxon> slots;
+  // Per bucket of a frozen set, the displacement that places the bucket's
+  // names in slots. Empty unless frozen.
+  std::vector<uint32_t> displace;
+  // The shards of a concurrent set, and afterwards their arenas.
+  std::unique_ptr<Shared> shared;
   bool frozen;
+  bool concurrent;
   TaxonSet(const TaxonSet &other);
   TaxonSet &operator=(const TaxonSet &other);
 
+  // The slot of table holding name, or the empty slot where it would go.
+  size_t probe(const std::vector<Taxon> &table, const char *name, size_t n,
+               uint64_t h) const;
+  Taxon find(const char *name, size_t n, uint64_t h) const;
+  void rehash(size_t nslots);
+  Taxon add_shared(const char *name, size_t n, uint64_t h);
+
  public:
   clade_bitset taxa_bs;
 
   TaxonSet(int size);
   TaxonSet(std::string str);
 
-  TaxonSet(const TaxonSet &&other);
-  TaxonSet &operator=(const TaxonSet &&other);
+  TaxonSet(TaxonSet &&other);
+  TaxonSet &operator=(TaxonSet &&other);
+  ~TaxonSet();
 
   BVFIterator begin() const { return taxa_bs.begin(); }
 
@@ -42,29 +109,63 @@ class TaxonSet {
   void add_clade_taxa(std::string str,
                       std::unordered_set<std::string> &taxa_set);
 
+  // No taxa can be added afterwards.
   void freeze();
+  bool is_frozen() const { return frozen; }
+
+  // Lets many threads add and look up names at once, such as threads
+  // reading the names of different gene trees, until canonicalize(). The
+  // names are split into shards by hash, each behind its own lock, and new
+  // taxa take the next number from a shared counter. No more taxa can be
+  // added than the set was made for, and taxa_bs and iteration over the set
+  // only show the new taxa after canonicalize().
+  void make_concurrent();
+  bool is_concurrent() const { return concurrent; }
+  // Ends the concurrent mode. The numbers the threads got depend on the
+  // order they came in, so the taxa added since make_concurrent() are
+  // renumbered in the order of their names, which makes the numbering the
+  // same on every run. Returns the new number of each taxon by its old one;
+  // the taxa from before make_concurrent() keep theirs.
+  std::vector<Taxon> canonicalize();
+
+  // Renumbers the taxa so that those in first come first, in that order,
+  // and the others follow in their current order; ts.renumber(
+  // tree.leaf_order()) numbers the taxa by the leaves of a reference tree,
+  // which turns most clades of similar trees into runs of bits. Returns the
+  // new number of each taxon by its old one. Clades, trees and distance
+  // matrices over the set have to be renumbered with it too, and containers
+  // hashed or ordered by clade, whose hashes and order change, rebuilt.
+  std::vector<Taxon> renumber(const std::vector<Taxon> &first);
 
   Taxon operator[](const std::string &str) { return add(str); }
 
-  Taxon operator[](const std::string &str) const { return index.at(str); }
-  const std::string &operator[](const Taxon i) const { return taxa.at(i); }
+  // Throws std::out_of_range for names not in the set.
+  Taxon operator[](const std::string &str) const;
+  TaxonName operator[](const Taxon i) const { return names.at(i); }
 
-  const std::string &get(const Taxon i) const { return taxa.at(i); }
+  TaxonName get(const Taxon i) const { return names.at(i); }
 
-  bool has(const std::string &str) const { return index.count(str) > 0; }
+  bool has(const std::string &str) const {
+    return find(str.data(), str.size()) >= 0;
+  }
+  // The taxon of name, or -1.
+  Taxon find(const char *name, size_t n) const;
 
   size_t size() const;
-  Taxon add(const std::string &str);
+  Taxon add(const std::string &str) { return add(str.data(), str.size()); }
+  Taxon add(const char *name, size_t n);
   std::string str() const {
     std::stringstream ss;
-    for (size_t i = 0; i < taxa.size(); i++) {
-      ss << i << "\t" << taxa[i] << std::endl;
+    for (size_t i = 0; i < size(); i++) {
+      ss << i << "\t" << names[i] << std::endl;
     }
     return ss.str();
   }
-  std::vector<std::string> &sort_taxa() {
-    std::sort(taxa.begin(), taxa.end());
-    return taxa;
+  // The names in lexicographic order.
+  std::vector<std::string> sort_taxa() const {
+    std::vector<TaxonName> sorted(names.begin(), names.begin() + size());
+    std::sort(sorted.begin(), sorted.end());
+    return std::vector<std::string>(sorted.begin(), sorted.end());
   }
 };
 
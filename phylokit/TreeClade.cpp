@@ -1,36 +1,56 @@
 #include "TreeClade.hpp"
+#include "CladeView.hpp"
+#include "IntervalClade.hpp"
 #include <glog/logging.h>
+#include <algorithm>
 
-Clade TreeClade::complement() const { return tree.root() - *this; }
+Clade TreeClade::complement() const {
+  return Clade(ts(), lazy(tree->root()) - *this);
+}
+
+int TreeClade::nchildren() const {
+  int n = 0;
+  for (int c : children()) {
+    (void) c;
+    n++;
+  }
+  return n;
+}
 
-TreeClade &TreeClade::child(int i) { return tree.node(children_.at(i)); }
+TreeClade &TreeClade::child(int i) {
+  int c = tree->first_child(index);
+  while (i--) {
+    c = tree->next_sibling(c);
+  }
+  return tree->node(c);
+}
 const TreeClade &TreeClade::child(int i) const {
-  return tree.node(children_.at(i));
+  return const_cast<TreeClade *>(this)->child(i);
 }
 bool TreeClade::verify() {
   Clade child_taxa(ts());
 
-  for (int i : children_) {
-    if (tree.node(i).parent != index) {
-      LOG(ERROR) << "Node " << i << " : " << tree.node(i) << " has wrong parent"
+  for (int i : children()) {
+    if (tree->node(i).parent() != index) {
+      LOG(ERROR) << "Node " << i << " : " << tree->node(i) << " has wrong parent"
                  << std::endl;
       return false;
     }
-    if (!tree.node(i).verify()) {
+    if (!tree->node(i).verify()) {
       return false;
     }
 
-    child_taxa += tree.node(i);
+    child_taxa += tree->node(i);
   }
 
   if (size() > 1 && !(child_taxa == *this)) {
-    LOG(ERROR) << "Node " << index << " : " << tree.node(index) << " has taxa "
+    LOG(ERROR) << "Node " << index << " : " << tree->node(index) << " has taxa "
                << static_cast<Clade>(*this) << std::endl;
     LOG(ERROR) << "when it should have taxa " << child_taxa << std::endl;
     LOG(ERROR) << "Children : " << std::endl;
-    for (int i : children_) {
-      LOG(ERROR) << tree.node(i) << " :: ";
-      LOG(ERROR) << static_cast<Clade>(tree.node(i)) << std::endl;
+    for (int i : children()) {
+      LOG(ERROR) << tree->node(i) << " :: ";
+      LOG(ERROR) << static_cast<Clade>(tree->node(i)) << std::endl;
     }
     return false;
   }
@@ -38,15 +58,6 @@ bool TreeClade::verify() {
   return true;
 }
 
-void TreeClade::addChild(int i) {
-  children_.push_back(i);
-  tree.node(i).parent = index;
-}
-
-std::vector<int> &TreeClade::children() { return children_; }
-
-const std::vector<int> &TreeClade::children() const { return children_; }
-
 std::ostream &operator<<(std::ostream &os, const TreeClade &tc) {
   if (tc.size() == 1) {
     for (Taxon t : tc) os << tc.ts()[t];
@@ -55,10 +66,10 @@ std::ostream &operator<<(std::ostream &os, const TreeClade &tc) {
 
   os << "(";
   int first = 1;
-  for (int i = 0; i < tc.nchildren(); i++) {
+  for (int c : tc.children()) {
     if (!first) os << ",";
     first = 0;
-    os << tc.child(i);
+    os << tc.tree->node(c);
   }
   os << ")";
   return os;
@@ -69,112 +80,375 @@ std::ostream &operator<<(std::ostream &os, const Tree &t) {
   return os;
 }
 
+void Tree::reserve(size_t n) {
+  parent_.reserve(n);
+  first_child_.reserve(n);
+  last_child_.reserve(n);
+  next_sibling_.reserve(n);
+  taxon_.reserve(n);
+  clades.reserve(n);
+}
+
+int Tree::addNode() {
+  int n = size();
+  parent_.push_back(-1);
+  first_child_.push_back(-1);
+  last_child_.push_back(-1);
+  next_sibling_.push_back(-1);
+  taxon_.push_back(-1);
+  if (has_lengths()) {
+    length_.push_back(0);
+  }
+  // A node without links has an empty clade.
+  if (has_clades_) {
+    clades.emplace_back(ts, *this, n, arena);
+  }
+  return n;
+}
+
+void Tree::addChild(int p, int c) {
+  link(p, c);
+  drop_clades();
+}
+
+void Tree::link(int p, int c) {
+  parent_[c] = p;
+  next_sibling_[c] = -1;
+  if (last_child_[p] < 0) {
+    first_child_[p] = c;
+  } else {
+    next_sibling_[last_child_[p]] = c;
+  }
+  last_child_[p] = c;
+}
+
+void Tree::set_taxon(int n, Taxon t) {
+  taxon_[n] = t;
+  drop_clades();
+}
+
+void Tree::drop_clades() {
+  if (has_clades_) {
+    clades.clear();
+    has_clades_ = false;
+  }
+}
+
+// Each leaf starts its clade with its taxon, and each node then adds its
+// clade to its parent's, children first: a pass backwards through a
+// preorder from every node without a parent.
+void Tree::compute_clades() const {
+  Tree *self = const_cast<Tree *>(this);
+  clades.clear();
+  clades.reserve(size());
+  std::vector<int> preorder, stack;
+  preorder.reserve(size());
+  for (int n = 0; n < size(); n++) {
+    clades.emplace_back(ts, *self, n, arena);
+    if (taxon_[n] >= 0) {
+      clades[n].add(taxon_[n]);
+    }
+    if (parent_[n] < 0) {
+      stack.push_back(n);
+    }
+  }
+  while (stack.size()) {
+    int n = stack.back();
+    stack.pop_back();
+    preorder.push_back(n);
+    for (int c : children(n)) {
+      stack.push_back(c);
+    }
+  }
+  for (size_t i = preorder.size(); i-- > 0;) {
+    int n = preorder[i];
+    if (parent_[n] >= 0) {
+      clades[parent_[n]] += clades[n];
+    }
+  }
+  has_clades_ = true;
+}
+
+void Tree::set_length(int n, double length) {
+  if (length_.empty()) {
+    length_.assign(size(), 0);
+  }
+  length_[n] = length;
+}
+
+// The n-th child of p.
+static int nth_child(const Tree &tree, int p, int n) {
+  int c = tree.first_child(p);
+  while (n--) {
+    c = tree.next_sibling(c);
+  }
+  return c;
+}
+
+// Keeps the clades up to date if they have been computed.
 Tree &Tree::binary_root(int a) {
-  if (root().nchildren() <= 2) {
+  int nchildren = 0;
+  for (int c : children(0)) {
+    (void) c;
+    nchildren++;
+  }
+  if (nchildren <= 2) {
     return *this;
   }
 
-  int c1 = root().children().at(a);
+  int c1 = nth_child(*this, 0, a);
   int c2 = addNode();
-  node(c2).parent = 0;
-  for (int i = 0; i < root().nchildren(); i++) {
-    if (i == a) {
+  for (int c = first_child_[0], next; c >= 0; c = next) {
+    next = next_sibling_[c];
+    if (c == c1) {
       continue;
     }
-    node(c2) += root().child(i);
-    node(c2).addChild(root().child(i).index);
-    root().child(i).parent = c2;
+    if (has_clades_) {
+      clades[c2] += clades[c];
+    }
+    link(c2, c);
   }
-  root().children().clear();
-  root().addChild(c1);
-  root().addChild(c2);
+  first_child_[0] = last_child_[0] = -1;
+  link(0, c1);
+  link(0, c2);
   return *this;
 }
 
+// Swapping the links that point at a and b, and then a's and b's own next
+// links, exchanges their places whether or not they are siblings, even
+// adjacent ones.
 void Tree::swap(int a, int b) {
-  int pa = node(a).parent;
-  int pb = node(b).parent;
+  swap_links(a, b);
+  drop_clades();
+}
 
-  for (int i = 0; i < node(pa).nchildren(); i++) {
-    if (node(pa).children()[i] == a) {
-      node(pa).children()[i] = b;
-    }
+void Tree::swap_links(int a, int b) {
+  int pa = parent_[a];
+  int pb = parent_[b];
+  int *slot_a = &first_child_[pa];
+  while (*slot_a != a) {
+    slot_a = &next_sibling_[*slot_a];
   }
-
-  for (int i = 0; i < node(pb).nchildren(); i++) {
-    if (node(pb).children()[i] == b) {
-      node(pb).children()[i] = a;
-    }
+  int *slot_b = &first_child_[pb];
+  while (*slot_b != b) {
+    slot_b = &next_sibling_[*slot_b];
   }
+  std::swap(*slot_a, *slot_b);
+  std::swap(next_sibling_[a], next_sibling_[b]);
 
-  node(a).parent = pb;
-  node(b).parent = pa;
+  bool a_last = last_child_[pa] == a;
+  bool b_last = last_child_[pb] == b;
+  if (a_last) {
+    last_child_[pa] = b;
+  }
+  if (b_last) {
+    last_child_[pb] = a;
+  }
+  parent_[a] = pb;
+  parent_[b] = pa;
 }
 
 Tree &Tree::rotate(int a_i, int b_i) {
-  TreeClade &acomp = root().child(1 - a_i);
-  TreeClade &a = root().child(a_i);
-  TreeClade &b = a.child(b_i);
+  int acomp = nth_child(*this, 0, 1 - a_i);
+  int a = nth_child(*this, 0, a_i);
+  int b = nth_child(*this, a, b_i);
 
-  swap(acomp.index, b.index);
+  swap_links(acomp, b);
 
-  a -= b;
-  a += acomp;
+  // Only a's clade changes: b moves up to the root and acomp down into a.
+  if (has_clades_) {
+    clades[a] -= clades[b];
+    clades[a] += clades[acomp];
+  }
 
   return *this;
 }
 
+// Follows the path from the root down to the leaf of x through the links,
+// so rerooting needs no clades.
 Tree &Tree::reroot(Taxon x) {
-  if (root().nchildren() > 2) {
-    binary_root(0);
+  int leaf = std::find(taxon_.begin(), taxon_.end(), x) - taxon_.begin();
+  if (leaf == size() || leaf == 0) {
+    return *this;
   }
   binary_root(0);
 
   while (true) {
-    for (int i = 0; i < root().nchildren(); i++) {
-      if (root().child(i).contains(x)) {
-        if (root().child(i).size() == 1) {
-          return *this;
-        }
-        for (int j = 0; j < root().child(i).nchildren(); j++) {
-          if (root().child(i).child(j).contains(x)) {
-            rotate(i, j);
-            break;
-          }
+    // The child of the root above the leaf, and its child above the leaf.
+    int c = leaf, g = -1;
+    while (parent_[c] != 0) {
+      g = c;
+      c = parent_[c];
+    }
+    if (is_leaf(c)) {
+      return *this;
+    }
+    int i = 0, j = 0;
+    for (int n = first_child_[0]; n != c; n = next_sibling_[n]) {
+      i++;
+    }
+    for (int n = first_child_[c]; n != g; n = next_sibling_[n]) {
+      j++;
+    }
+    rotate(i, j);
+  }
+}
+
+// Each pair of taxa gets the node where they part ways, between two of its
+// children, so every entry is written once rather than once per common
+// ancestor as a walk over the nodes' bitsets would.
+void Tree::LCA(DistanceMatrix &lca) const {
+  TreeIntervals intervals(*this);
+  for (int n = 0; n < size(); n++) {
+    const IntervalClade &c = intervals[n];
+    if (c.empty()) {
+      continue;
+    }
+    if (is_leaf(n)) {
+      lca(taxon_[n], taxon_[n]) = n;
+      continue;
+    }
+    // The children's intervals tile c in order, so the taxa in later
+    // children are the ones after the end of this child's interval.
+    for (int ch = first_child_[n]; next_sibling_[ch] >= 0;
+         ch = next_sibling_[ch]) {
+      const IntervalClade &a = intervals[ch];
+      for (int p = a.lo; p <= a.hi; p++) {
+        Taxon t1 = intervals.taxon(p);
+        for (int q = a.hi + 1; q <= c.hi; q++) {
+          lca(t1, intervals.taxon(q)) = n;
         }
-        break;
       }
     }
   }
-
-  return *this;
 }
 
-void Tree::LCA(DistanceMatrix &lca) const {
+std::vector<Taxon> Tree::leaf_order() const {
+  std::vector<Taxon> leaves;
   std::vector<int> stack;
   stack.push_back(0);
-
   while (stack.size()) {
-    int ind = stack.back();
-    const TreeClade &tc = node(ind);
+    int n = stack.back();
     stack.pop_back();
+    if (is_leaf(n)) {
+      leaves.push_back(taxon_[n]);
+      continue;
+    }
+    // Pushing the children in order and reversing them on the stack keeps
+    // the leftmost on top.
+    size_t first = stack.size();
+    for (int c : children(n)) {
+      stack.push_back(c);
+    }
+    std::reverse(stack.begin() + first, stack.end());
+  }
+  return leaves;
+}
 
-    for (Taxon i : tc) {
-      for (Taxon j : tc) {
-        lca(i, j) = ind;
-      }
+void Tree::renumber(const std::vector<Taxon> &order) {
+  for (Taxon &t : taxon_) {
+    if (t >= 0) {
+      t = order[t];
     }
+  }
+  // Clades not yet computed will be from the new taxa.
+  for (TreeClade &c : clades) {
+    c.renumber(order);
+  }
+}
+
+std::unordered_set<Split> Tree::splits() const {
+  return splits(taxa());
+}
 
-    for (int i = 0; i < tc.nchildren(); i++) {
-      stack.push_back(tc.children().at(i));
+std::unordered_set<Split> Tree::splits(const Clade &taxa) const {
+  build_clades();
+  std::unordered_set<Split> out;
+  int ntaxa = taxa.size();
+  int reference = taxa.get_taxa().ffs();
+  for (const Clade &c : clades) {
+    // Trivial splits are counted off without building their sides, and the
+    // side with the reference taxon is complemented in one pass.
+    int n = c.overlap_size(taxa);
+    if (n < 2 || ntaxa - n < 2) {
+      continue;
     }
+    out.insert(Split(c.contains(reference)
+                         ? Clade(taxa.ts(), lazy(taxa) - c)
+                         : c.overlap(taxa),
+                     taxa));
   }
+  return out;
 }
 
-double Tree::RFDist(const Tree &other, bool normalized) const {
+// The clades of the nodes of t but the root, restricted to taxa, as rows of
+// nwords words each.
+static void restricted_rows(const Tree &t, const Clade &taxa, size_t nwords,
+                            std::vector<elem_type> &rows) {
+  std::vector<elem_type> mask(nwords, 0);
+  taxa.get_taxa().copy_words(mask.data());
+  rows.assign((t.size() - 1) * nwords, 0);
+  for (int i = 1; i < t.size(); i++) {
+    elem_type *row = &rows[(i - 1) * nwords];
+    t.node(i).get_taxa().copy_words(row);
+    for (size_t w = 0; w < nwords; w++) {
+      row[w] &= mask[w];
+    }
+  }
+}
+
+// The rooted distance on views of the clades as rows of two flat arrays,
+// hashing and comparing their words in place instead of building a Clade
+// for each node. For taxon sets narrow enough that a dense row per node is
+// cheap.
+double Tree::rooted_rf(const Tree &other, bool normalized) const {
+  size_t nwords = fixed_words_for((ts.size() + 8 * sizeof(elem_type) - 1) /
+                                  (8 * sizeof(elem_type)));
+  std::vector<elem_type> mine, theirs;
+  restricted_rows(*this, other.taxa(), nwords, mine);
+  restricted_rows(other, taxa(), nwords, theirs);
+  std::unordered_set<CladeView> my_clades;
+  for (size_t i = 0; i < mine.size(); i += nwords) {
+    my_clades.insert(CladeView(&mine[i], nwords));
+  }
+
+  double matching = 0;
+  double count = 0;
+  for (size_t i = 0; i < theirs.size(); i += nwords) {
+    CladeView c(&theirs[i], nwords);
+    if (c.size() <= 1) {
+      continue;
+    }
+    count++;
+    matching += my_clades.count(c);
+  }
+  if (normalized)
+    return 1 - (matching / count);
+  else
+    return count - matching;
+}
+
+double Tree::RFDist(const Tree &other, bool normalized, bool unrooted) const {
+  if (unrooted) {
+    Clade common = taxa().overlap(other.taxa());
+    std::unordered_set<Split> my_splits = splits(common);
+    double matching = 0;
+    double count = 0;
+    for (const Split &s : other.splits(common)) {
+      count++;
+      matching += my_splits.count(s);
+    }
+    if (normalized)
+      return 1 - (matching / count);
+    else
+      return count - matching;
+  }
+  if (ts.size() < BitVectorFixed::sparse_min_bits && &ts == &other.ts) {
+    return rooted_rf(other, normalized);
+  }
   std::unordered_set<Clade> my_clades;
-  for (size_t i = 1; i < clades.size(); i++) {
-    Clade ol = clades.at(i).overlap(other.taxa());
+  for (int i = 1; i < size(); i++) {
+    Clade ol = node(i).overlap(other.taxa());
     my_clades.emplace(ol);
     //    cout << "adding " << ol << endl;
   }
@@ -182,15 +456,15 @@ double Tree::RFDist(const Tree &other, bool normalized) const {
   double matching = 0;
   double count = 0;
 
-  for (size_t i = 1; i < other.clades.size(); i++) {
-    if (other.clades.at(i).overlap_size(taxa()) <= 1) {
+  for (int i = 1; i < other.size(); i++) {
+    if (other.node(i).overlap_size(taxa()) <= 1) {
       continue;
     }
     count++;
-    if (my_clades.count(other.clades.at(i).overlap(taxa()))) {
+    if (my_clades.count(other.node(i).overlap(taxa()))) {
       matching++;
     } else {
-      //    cout << "couldn't find " << other.clades.at(i) << endl;
+      //    cout << "couldn't find " << other.node(i) << endl;
     }
   }
   if (normalized)
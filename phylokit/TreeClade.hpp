@@ -1,94 +1,213 @@
 #ifndef __TREECLADE_HPP__
 #define __TREECLADE_HPP__
 
+#include <cassert>
 #include <iostream>
+#include <utility>
+#include <vector>
 #include "Clade.hpp"
 #include "DistanceMatrix.hpp"
 class Tree;
 
-class TreeClade : public Clade {
+// The children of a node in order, walked through Tree's sibling links.
+class ChildRange {
+ public:
+  class iterator {
+   public:
+    iterator(const int *next, int n) : next(next), n(n) {}
+    int operator*() const { return n; }
+    iterator &operator++() {
+      n = next[n];
+      return *this;
+    }
+    bool operator!=(const iterator &other) const { return n != other.n; }
+    bool operator==(const iterator &other) const { return n == other.n; }
+
+   private:
+    const int *next;
+    int n;
+  };
+
+  ChildRange(const int *next, int first) : next(next), first(first) {}
+  iterator begin() const { return iterator(next, first); }
+  iterator end() const { return iterator(next, -1); }
+  bool empty() const { return first < 0; }
+
  private:
+  const int *next;
+  int first;
+};
+
+// The clade of a node of a Tree. The tree keeps the node's links; the clade
+// only knows its index and the tree, to answer for them.
+class TreeClade : public Clade {
  public:
-  std::vector<int> children_;
-  int parent;
   int index;
-  Tree &tree;
+  Tree *tree;
   using Clade::Clade;
-  TreeClade(TaxonSet &ts, Tree &tree, int index)
-      : Clade(ts), index(index), tree(tree) {}
-  TreeClade(TaxonSet& ts, Tree &tree, const TreeClade& other)
-      : Clade(other), 
-        children_(other.children_), 
-        parent(other.parent),
-        index(other.index), 
-        tree(tree) {}
-  TreeClade(TaxonSet& ts, Tree &tree, const TreeClade&& other)
-      : Clade(other), 
-        children_(other.children_), 
-        parent(other.parent),
-        index(other.index), 
-        tree(tree) {}
-  void addChild(int index);
-  std::vector<int> &children();
-  const std::vector<int> &children() const;
-  int nchildren() const { return children_.size(); }
+  TreeClade(TaxonSet &ts, Tree &tree, int index, CladeArena *arena = NULL)
+      : Clade(ts, arena), index(index), tree(&tree) {}
+  // Appends node i to the children of this node.
+  void addChild(int i);
+  int parent() const;
+  ChildRange children() const;
+  int nchildren() const;
+  // The i-th child, found by walking the siblings before it.
   TreeClade &child(int i);
   const TreeClade &child(int i) const;
   Clade complement() const;
   bool verify();
 };
 
+// A rooted tree as columns indexed by node: the parent, first and last child
+// and next sibling of each node (-1 where there is none), the taxon of each
+// leaf, the branch lengths if there are any, and the clade of each node.
+// Nodes are numbered from 0, the root, in the order they are added; a node
+// is an index, and the links copy as plain arrays.
+//
+// The clades are computed together, children into parents, the first time
+// node() or anything else that reads them is called, so code that only
+// walks the links never builds them. That first call is not safe to make
+// from several threads at once, even on a const Tree.
 class Tree {
- private:
  public:
-  std::unordered_map<int, TreeClade> clades;
-  int next_entry;
   TaxonSet &ts;
+  // Where the clades keep their bitsets, or NULL for the heap. Copies of a
+  // tree use the heap.
+  CladeArena *arena;
 
-  Tree(TaxonSet &ts) : next_entry(0), ts(ts) {}
-  Tree(const Tree &other) : 
-    next_entry(other.next_entry),
-    ts(other.ts) {
-      for (auto& i : other.clades) {
-        clades.emplace(i.first, TreeClade(ts, *this, i.second));
-      }
+  Tree(TaxonSet &ts, CladeArena *arena = NULL)
+      : ts(ts), arena(arena), has_clades_(false) {}
+  // Copies only the links, taxa and lengths; the copy computes its clades
+  // again when first asked.
+  Tree(const Tree &other)
+      : ts(other.ts), arena(NULL), parent_(other.parent_),
+        first_child_(other.first_child_), last_child_(other.last_child_),
+        next_sibling_(other.next_sibling_), taxon_(other.taxon_),
+        length_(other.length_), has_clades_(false) {}
+  // Moving keeps every clade and its bitset in place; only the clades' back
+  // pointers to the tree are updated.
+  Tree(Tree &&other) noexcept
+      : ts(other.ts), arena(other.arena), parent_(std::move(other.parent_)),
+        first_child_(std::move(other.first_child_)),
+        last_child_(std::move(other.last_child_)),
+        next_sibling_(std::move(other.next_sibling_)),
+        taxon_(std::move(other.taxon_)), length_(std::move(other.length_)),
+        clades(std::move(other.clades)), has_clades_(other.has_clades_) {
+    for (TreeClade &c : clades) {
+      c.tree = this;
+    }
   }
-  Tree(Tree &&other)  : 
-    next_entry(other.next_entry),
-    ts(other.ts) {
-      for (auto& i : other.clades) {
-        clades.emplace(i.first, TreeClade(ts, *this, i.second));
-      }
+
+  // The number of nodes.
+  int size() const { return parent_.size(); }
+  void reserve(size_t n);
+
+  TreeClade &root() { return node(0); }
+  const TreeClade &root() const { return node(0); }
+  TreeClade &node(int n) {
+    assert(n >= 0 && n < size());
+    build_clades();
+    return clades[n];
   }
+  const TreeClade &node(int n) const {
+    assert(n >= 0 && n < size());
+    build_clades();
+    return clades[n];
+  }
+  // Whether the clades have been computed since the links last changed.
+  bool has_clades() const { return has_clades_; }
 
-  TreeClade &root() { return clades.at(0); }
-  const TreeClade &root() const { return clades.at(0); }
-  TreeClade &node(int n) { return clades.at(n); }
-  const TreeClade &node(int n) const { return clades.at(n); }
-  int addNode() {
-    Tree &me = *this;
-    // clades.emplace(piecewise_construct, make_tuple(next_entry),
-    // make_tuple(ts, me, next_entry));
-    clades.insert(std::make_pair(next_entry, TreeClade(ts, me, next_entry)));
-    clades.at(next_entry).parent = -1;
-    next_entry++;
-    return next_entry - 1;
+  int parent(int n) const { return parent_[n]; }
+  int first_child(int n) const { return first_child_[n]; }
+  int last_child(int n) const { return last_child_[n]; }
+  int next_sibling(int n) const { return next_sibling_[n]; }
+  ChildRange children(int n) const {
+    return ChildRange(next_sibling_.data(), first_child_[n]);
   }
+  bool is_leaf(int n) const { return first_child_[n] < 0; }
+  // The taxon of a leaf, or -1.
+  Taxon taxon(int n) const { return taxon_[n]; }
+  bool has_lengths() const { return !length_.empty(); }
+  // The length of the branch above n, 0 if the tree has none.
+  double length(int n) const { return length_.empty() ? 0 : length_[n]; }
+
+  // Adds a node with no parent and no children. With the clades computed,
+  // this grows them and may move them, so references to the nodes from
+  // node(), root() or child() no longer hold.
+  int addNode();
+  // Appends node c, which has no parent, to the children of p. This and
+  // set_taxon drop the clades, to be computed again when next needed, and
+  // with them any references to the nodes.
+  void addChild(int p, int c);
+  // Makes n a leaf for taxon t.
+  void set_taxon(int n, Taxon t);
+  void set_length(int n, double length);
 
   const Clade &taxa() const { return root(); }
 
+  // Moves all children of the root but the a-th under a new node. Like
+  // addNode, invalidates references to the nodes.
   Tree &binary_root(int a);
 
+  // Exchanges the places of nodes a and b, with their subtrees, among the
+  // children of their parents. Drops the clades like addChild.
   void swap(int a, int b);
 
   Tree &rotate(int a_i, int b_i);
 
+  // Roots the tree at the leaf of x, through binary_root, and so also
+  // invalidates references to the nodes.
   Tree &reroot(Taxon x);
 
   void LCA(DistanceMatrix &lca) const;
 
-  double RFDist(const Tree &other, bool normalized = true) const;
+  // The taxa of the leaves from left to right, for TaxonSet::renumber.
+  std::vector<Taxon> leaf_order() const;
+  // Renumbers the leaves and the clades of all nodes after
+  // TaxonSet::renumber.
+  void renumber(const std::vector<Taxon> &order);
+
+  // The non-trivial splits of the tree, read as unrooted, after restricting
+  // it to taxa (by default all of its own).
+  std::unordered_set<Split> splits() const;
+  std::unordered_set<Split> splits(const Clade &taxa) const;
+
+  // The clades (or, if unrooted, the splits) of other that this tree lacks,
+  // on the taxa the trees share. Normalized, as a fraction of those of other.
+  double RFDist(const Tree &other, bool normalized = true,
+                bool unrooted = false) const;
+
+ private:
+  double rooted_rf(const Tree &other, bool normalized) const;
+  void link(int p, int c);
+  // swap() without dropping the clades, for callers that fix them up.
+  void swap_links(int a, int b);
+  void build_clades() const {
+    if (!has_clades_) {
+      compute_clades();
+    }
+  }
+  void compute_clades() const;
+  void drop_clades();
+
+  std::vector<int> parent_;
+  std::vector<int> first_child_;
+  std::vector<int> last_child_;
+  std::vector<int> next_sibling_;
+  std::vector<Taxon> taxon_;
+  // Empty until a length is set.
+  std::vector<double> length_;
+  mutable std::vector<TreeClade> clades;
+  mutable bool has_clades_;
 };
+
+inline int TreeClade::parent() const { return tree->parent(index); }
+inline ChildRange TreeClade::children() const {
+  return tree->children(index);
+}
+inline void TreeClade::addChild(int i) { tree->addChild(index, i); }
+
 std::ostream &operator<<(std::ostream &os, const Tree &t);
 std::ostream &operator<<(std::ostream &os, const TreeClade &t);
 
@@ -0,0 +1,360 @@
+#include "TreeGenerator.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Writes x >= 0 with six decimals at p, without going through printf, and
+// returns the end. Takes at most 28 bytes.
+char *write_length(char *p, double x) {
+  uint64_t fixed = (uint64_t) (x * 1e6 + 0.5);
+  char buf[32];
+  char *q = buf + sizeof(buf);
+  for (int i = 0; i < 6; i++) {
+    *--q = '0' + fixed % 10;
+    fixed /= 10;
+  }
+  *--q = '.';
+  do {
+    *--q = '0' + fixed % 10;
+    fixed /= 10;
+  } while (fixed);
+  size_t n = buf + sizeof(buf) - q;
+  memcpy(p, q, n);
+  return p + n;
+}
+
+}  // namespace
+
+int SimTree::add(int p, double len, Taxon t) {
+  parent.push_back(p);
+  length.push_back(len);
+  taxon.push_back(t);
+  return parent.size() - 1;
+}
+
+void SimTree::reserve(size_t n) {
+  parent.reserve(n);
+  length.reserve(n);
+  taxon.reserve(n);
+}
+
+void SimTree::clear() {
+  parent.clear();
+  length.clear();
+  taxon.clear();
+  root = -1;
+}
+
+void SimTree::children(std::vector<int> &first, std::vector<int> &kids) const {
+  first.assign(size() + 2, 0);
+  for (size_t v = 0; v < size(); v++) {
+    if (parent[v] >= 0) first[parent[v] + 2]++;
+  }
+  for (size_t v = 1; v <= size(); v++) {
+    first[v + 1] += first[v];
+  }
+  // Filling shifts the counts down by one, to where first[v] is the start
+  // of v's children.
+  kids.resize(first[size() + 1]);
+  for (size_t v = 0; v < size(); v++) {
+    if (parent[v] >= 0) kids[first[parent[v] + 1]++] = v;
+  }
+  first.pop_back();
+}
+
+void SimTree::top_down(const std::vector<int> &first,
+                       const std::vector<int> &kids,
+                       std::vector<int> &order) const {
+  order.clear();
+  if (root < 0) {
+    return;
+  }
+  order.push_back(root);
+  for (size_t i = 0; i < order.size(); i++) {
+    int v = order[i];
+    order.insert(order.end(), kids.begin() + first[v],
+                 kids.begin() + first[v + 1]);
+  }
+}
+
+TreeGenerator::TreeGenerator(const TaxonSet &ts, uint64_t seed)
+    : ts(ts), rng(seed) {}
+
+double TreeGenerator::uniform() {
+  return (rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+size_t TreeGenerator::uniform(size_t n) {
+  return rng() % n;
+}
+
+double TreeGenerator::exponential(double rate) {
+  return -std::log(1 - uniform()) / rate;
+}
+
+std::vector<Taxon> TreeGenerator::shuffled_taxa() {
+  std::vector<Taxon> taxa;
+  for (Taxon t = 0; t < (Taxon) ts.size(); t++) {
+    taxa.push_back(t);
+  }
+  for (size_t i = taxa.size(); i > 1; i--) {
+    std::swap(taxa[i - 1], taxa[uniform(i)]);
+  }
+  return taxa;
+}
+
+SimTree TreeGenerator::yule(double birth_rate) {
+  std::vector<Taxon> taxa = shuffled_taxa();
+  SimTree tree;
+  if (taxa.empty()) {
+    return tree;
+  }
+  tree.reserve(2 * taxa.size());
+  // Node times, counted forward from the root; tips get theirs at the end.
+  std::vector<double> &time = age;
+  time.assign(1, 0);
+  tree.root = tree.add(-1, 0, -1);
+  std::vector<int> &tips = order;
+  tips.assign(1, tree.root);
+  double now = 0;
+  while (tips.size() < taxa.size()) {
+    now += exponential(birth_rate * tips.size());
+    size_t i = uniform(tips.size());
+    int v = tips[i];
+    time[v] = now;
+    tips[i] = tree.add(v, 0, -1);
+    tips.push_back(tree.add(v, 0, -1));
+    time.resize(tree.size(), 0);
+  }
+  now += exponential(birth_rate * tips.size());
+  for (size_t i = 0; i < tips.size(); i++) {
+    time[tips[i]] = now;
+    tree.taxon[tips[i]] = taxa[i];
+  }
+  for (size_t v = 0; v < tree.size(); v++) {
+    if (tree.parent[v] >= 0) {
+      tree.length[v] = time[v] - time[tree.parent[v]];
+    }
+  }
+  return tree;
+}
+
+SimTree TreeGenerator::caterpillar() {
+  std::vector<Taxon> taxa = shuffled_taxa();
+  SimTree tree;
+  tree.reserve(2 * taxa.size());
+  if (taxa.size() == 1) {
+    tree.root = tree.add(-1, 0, taxa[0]);
+    return tree;
+  }
+  tree.root = tree.add(-1, 0, -1);
+  int spine = tree.root;
+  for (size_t i = 0; i + 2 < taxa.size(); i++) {
+    tree.add(spine, 1, taxa[i]);
+    spine = tree.add(spine, 1, -1);
+  }
+  for (size_t i = taxa.size() >= 2 ? taxa.size() - 2 : 0; i < taxa.size();
+       i++) {
+    tree.add(spine, 1, taxa[i]);
+  }
+  return tree;
+}
+
+SimTree TreeGenerator::coalescent(const SimTree &species, double scale) {
+  species.children(first, kids);
+  species.top_down(first, kids, order);
+  // Ages of the species nodes, from the leaves up.
+  age.assign(species.size(), 0);
+  for (size_t i = order.size(); i-- > 1;) {
+    int v = order[i], p = species.parent[v];
+    age[p] = std::max(age[p], age[v] + species.length[v] * scale);
+  }
+
+  SimTree gene;
+  gene.reserve(2 * species.size());
+  // Ages of the gene tree nodes, kept in its lengths until their parents
+  // are known.
+  std::vector<double> &gene_age = gene.length;
+  // The gene lineages at the bottom of each species branch, filled in as
+  // its children are done.
+  lineages.resize(species.size());
+  for (size_t i = order.size(); i-- > 0;) {
+    int v = order[i], p = species.parent[v];
+    std::vector<int> &here = lineages[v];
+    if (species.taxon[v] >= 0) {
+      here.push_back(gene.add(-1, 0, species.taxon[v]));
+    }
+    double now = age[v];
+    double end = p >= 0 ? age[p] : std::numeric_limits<double>::infinity();
+    while (here.size() > 1) {
+      double k = here.size();
+      now += exponential(k * (k - 1) / 2);
+      if (now > end) {
+        break;
+      }
+      size_t a = uniform(here.size());
+      std::swap(here[a], here.back());
+      int x = here.back();
+      here.pop_back();
+      size_t b = uniform(here.size());
+      int y = here[b];
+      int m = gene.add(-1, now, -1);
+      gene.parent[x] = gene.parent[y] = m;
+      gene_age[x] = now - gene_age[x];
+      gene_age[y] = now - gene_age[y];
+      here[b] = m;
+    }
+    if (p >= 0) {
+      lineages[p].insert(lineages[p].end(), here.begin(), here.end());
+    } else if (here.size()) {
+      gene.root = here[0];
+      gene.length[gene.root] = 0;
+    }
+    here.clear();
+  }
+  return gene;
+}
+
+void TreeGenerator::prune(SimTree &tree) {
+  tree.children(first, kids);
+  tree.top_down(first, kids, order);
+  // Kept leaves below each node, from the leaves up.
+  below.assign(tree.size(), 0);
+  for (size_t i = order.size(); i-- > 0;) {
+    int v = order[i];
+    if (tree.taxon[v] >= 0) below[v] = keep[v];
+    if (tree.parent[v] >= 0) below[tree.parent[v]] += below[v];
+  }
+  kept.assign(tree.size(), 0);
+  for (int v : order) {
+    if (tree.taxon[v] >= 0) {
+      kept[v] = keep[v];
+      continue;
+    }
+    int branches = 0;
+    for (int i = first[v]; i < first[v + 1]; i++) {
+      branches += below[kids[i]] > 0;
+    }
+    kept[v] = branches >= 2 && (v == tree.root || !contract[v]);
+  }
+
+  // From the root down, each node's nearest kept ancestor and the length
+  // of the path to it, which becomes its branch.
+  up.assign(tree.size(), -1);
+  id.assign(tree.size(), -1);
+  dist.assign(tree.size(), 0);
+  pruned.clear();
+  for (int v : order) {
+    int p = tree.parent[v];
+    if (p >= 0) {
+      up[v] = kept[p] ? p : up[p];
+      dist[v] = tree.length[v] + (kept[p] ? 0 : dist[p]);
+    }
+    if (kept[v]) {
+      bool top = up[v] < 0;
+      id[v] = pruned.add(top ? -1 : id[up[v]], top ? 0 : dist[v],
+                         tree.taxon[v]);
+      if (top) pruned.root = id[v];
+    }
+  }
+  std::swap(tree, pruned);
+}
+
+void TreeGenerator::drop_taxa(SimTree &tree, double p, size_t min_leaves) {
+  keep.assign(tree.size(), 1);
+  contract.assign(tree.size(), 0);
+  std::vector<int> &leaves = id;
+  leaves.clear();
+  for (size_t v = 0; v < tree.size(); v++) {
+    if (tree.taxon[v] >= 0) leaves.push_back(v);
+  }
+  // Drop from a shuffled order so the survivors are uniform when the floor
+  // is hit.
+  for (size_t i = leaves.size(); i > 1; i--) {
+    std::swap(leaves[i - 1], leaves[uniform(i)]);
+  }
+  size_t left = leaves.size();
+  for (int v : leaves) {
+    if (left > min_leaves && uniform() < p) {
+      keep[v] = 0;
+      left--;
+    }
+  }
+  prune(tree);
+}
+
+void TreeGenerator::collapse(SimTree &tree, double p) {
+  keep.assign(tree.size(), 1);
+  contract.assign(tree.size(), 0);
+  for (size_t v = 0; v < tree.size(); v++) {
+    contract[v] = tree.taxon[v] < 0 && (int) v != tree.root && uniform() < p;
+  }
+  prune(tree);
+}
+
+void TreeGenerator::write_newick(const SimTree &tree, std::string &out,
+                                 bool lengths) const {
+  // Written through a pointer into room for the longest possible output,
+  // which is cut back at the end.
+  size_t bound = 1;
+  for (size_t v = 0; v < tree.size(); v++) {
+    bound += (tree.taxon[v] >= 0 ? ts[tree.taxon[v]].size() : 2) + 1 +
+             (lengths ? 29 : 0);
+  }
+  size_t start = out.size();
+  out.resize(start + bound);
+  char *p = &out[start];
+  if (tree.root >= 0) {
+    tree.children(first, kids);
+  }
+  // Each frame is a node and how many of its children are written.
+  frames.clear();
+  if (tree.root >= 0) {
+    frames.push_back(std::make_pair(tree.root, 0));
+  }
+  while (frames.size()) {
+    int v = frames.back().first;
+    int done = frames.back().second;
+    if (tree.taxon[v] >= 0) {
+      TaxonName name = ts[tree.taxon[v]];
+      memcpy(p, name.data(), name.size());
+      p += name.size();
+    } else if (done < first[v + 1] - first[v]) {
+      *p++ = done ? ',' : '(';
+      frames.back().second++;
+      frames.push_back(std::make_pair(kids[first[v] + done], 0));
+      continue;
+    } else {
+      *p++ = ')';
+    }
+    if (lengths && v != tree.root) {
+      *p++ = ':';
+      p = write_length(p, tree.length[v]);
+    }
+    frames.pop_back();
+  }
+  *p++ = ';';
+  out.resize(p - &out[0]);
+}
+
+Tree TreeGenerator::to_tree(const SimTree &tree, TaxonSet &ts) const {
+  Tree out(ts);
+  out.reserve(tree.size());
+  std::vector<int> index(tree.size());
+  tree.children(first, kids);
+  tree.top_down(first, kids, order);
+  for (int v : order) {
+    index[v] = out.addNode();
+    if (v != tree.root) {
+      out.addChild(index[tree.parent[v]], index[v]);
+      out.set_length(index[v], tree.length[v]);
+    }
+    if (tree.taxon[v] >= 0) {
+      out.set_taxon(index[v], tree.taxon[v]);
+    }
+  }
+  return out;
+}
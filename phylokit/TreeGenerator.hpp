@@ -0,0 +1,91 @@
+#ifndef TREEGENERATOR_HPP__
+#define TREEGENERATOR_HPP__
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TaxonSet.hpp"
+#include "TreeClade.hpp"
+
+// A rooted tree with branch lengths as a parent array, the form the
+// generator simulates and prunes trees in; to_tree() turns it into a Tree.
+// Leaves carry a taxon and internal nodes -1. Any node may be the root.
+struct SimTree {
+  std::vector<int> parent;
+  // Of the branch above each node; 0 for the root.
+  std::vector<double> length;
+  std::vector<Taxon> taxon;
+  int root;
+
+  SimTree() : root(-1) {}
+  int add(int parent, double length, Taxon taxon);
+  void reserve(size_t n);
+  void clear();
+  size_t size() const { return parent.size(); }
+  // Each node's children, as first[v] .. first[v + 1] in kids.
+  void children(std::vector<int> &first, std::vector<int> &kids) const;
+  // The nodes breadth first from the root, so each comes after its parent,
+  // given the children.
+  void top_down(const std::vector<int> &first, const std::vector<int> &kids,
+                std::vector<int> &order) const;
+};
+
+// Random species and gene trees over the taxa of a TaxonSet, reproducible
+// from a seed: the generator draws only raw 64-bit words from
+// std::mt19937_64 and does its own sampling, so a seed gives the same trees
+// with every standard library. Everything runs in time linear in the
+// number of taxa, without recursion, so caterpillars over 1e5 taxa are fine.
+class TreeGenerator {
+ public:
+  TreeGenerator(const TaxonSet &ts, uint64_t seed);
+
+  // A pure-birth tree with the given speciation rate, cut off at the time
+  // the last taxon appears plus one more waiting time. The taxa are
+  // shuffled onto the leaves.
+  SimTree yule(double birth_rate = 1);
+  // A ladder over the shuffled taxa with unit branch lengths.
+  SimTree caterpillar();
+  // A gene tree under the multispecies coalescent, with one lineage per
+  // leaf of species, a tree over the same taxa. Branch lengths of species
+  // times scale are in coalescent units; internal branches are stretched
+  // where needed to make it ultrametric. Larger scales give gene trees
+  // closer to the species tree.
+  SimTree coalescent(const SimTree &species, double scale = 1);
+
+  // Removes each leaf with probability p, suppressing the nodes left with
+  // a single child, but always keeps at least min_leaves leaves.
+  void drop_taxa(SimTree &tree, double p, size_t min_leaves = 4);
+  // Contracts each internal branch but the root's with probability p,
+  // making polytomies.
+  void collapse(SimTree &tree, double p);
+
+  // Appends the tree in newick, with a ';' and no newline, using the taxon
+  // names of the TaxonSet. Lengths are written with six decimals.
+  void write_newick(const SimTree &tree, std::string &out,
+                    bool lengths) const;
+  Tree to_tree(const SimTree &tree, TaxonSet &ts) const;
+
+ private:
+  double uniform();
+  size_t uniform(size_t n);
+  double exponential(double rate);
+  std::vector<Taxon> shuffled_taxa();
+  // Keeps the leaves with keep set and the internal nodes that still have
+  // two children and are not contracted, joining branches across the rest.
+  void prune(SimTree &tree);
+
+  const TaxonSet &ts;
+  std::mt19937_64 rng;
+  // Scratch space kept between trees, so a tree costs no allocations
+  // beyond its own.
+  mutable std::vector<int> first, kids, order;
+  mutable std::vector<std::pair<int, int>> frames;
+  std::vector<std::vector<int>> lineages;
+  std::vector<int> below, up, id;
+  std::vector<char> keep, contract, kept;
+  std::vector<double> age, dist;
+  SimTree pruned;
+};
+
+#endif  // TREEGENERATOR_HPP__
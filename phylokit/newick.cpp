@@ -1,7 +1,9 @@
 #include "newick.hpp"
 #include "TreeClade.hpp"
 #include <glog/logging.h>
+#include <cstdlib>
 #include <iostream>
+#include <utility>
 
 using std::endl;
 
@@ -32,6 +34,33 @@ int newick_to_ts(const std::string &s, std::unordered_set<std::string> &taxa) {
   return taxon_count;
 }
 
+int newick_to_ts(const std::string &s, TaxonSet &ts) {
+  typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
+  boost::char_separator<char> sep(";\n", "(),:");
+  tokenizer tokens(s, sep);
+
+  int taxon_count = 0;
+
+  std::string prevtok = "";
+
+  for (auto tok : tokens) {
+    boost::algorithm::trim(tok);
+
+    if (tok == ":" || tok == "," || tok == "(" || tok == ")") {
+    } else {
+      if ((prevtok == ")") || (prevtok == ":")) {
+        continue;
+      }
+      if (tok.find_first_not_of(' ') != std::string::npos) {
+        ts.add(tok);
+        taxon_count++;
+      }
+    }
+    prevtok = tok;
+  }
+  return taxon_count;
+}
+
 Clade newick_to_taxa(const std::string &s, TaxonSet &ts) {
   typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
   boost::char_separator<char> sep(";\n", "():,");
@@ -62,24 +91,36 @@ Clade newick_to_taxa(const std::string &s, TaxonSet &ts) {
   return clade;
 }
 
-void newick_to_clades(const std::string &s, TaxonSet &ts,
-                      std::unordered_set<Clade> &clade_set) {
+// Builds the clade of each internal node of s once: a leaf adds its taxon to
+// the innermost open clade, and a clade that closes is added to the one
+// around it before visit(clade, n) sees it, where n numbers the internal
+// nodes in preorder from 0 at the root. Clades are visited children first,
+// and visit may move them away.
+template <class Visit>
+static void visit_clades(const std::string &s, TaxonSet &ts,
+                         CladeArena *arena, Visit visit) {
   typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
   boost::char_separator<char> sep(";\n", "():,");
 
   tokenizer tokens(s, sep);
 
-  std::vector<size_t> active;
-  std::vector<Clade> clades;
+  std::vector<Clade> open;
+  std::vector<size_t> preorder;
+  size_t next = 0;
 
   std::string prevtok = "";
 
   for (auto tok : tokens) {
     if (tok == "(") {
-      clades.emplace_back(ts);
-      active.push_back(clades.size() - 1);
+      open.emplace_back(ts, arena);
+      preorder.push_back(next++);
     } else if (tok == ")") {
-      active.pop_back();
+      if (open.size() > 1) {
+        open[open.size() - 2] += open.back();
+      }
+      visit(open.back(), preorder.back());
+      open.pop_back();
+      preorder.pop_back();
     } else if (tok == ":") {
     } else if (tok == ",") {
     } else {
@@ -90,27 +131,90 @@ void newick_to_clades(const std::string &s, TaxonSet &ts,
       boost::algorithm::trim(tok);
       Taxon id = ts[tok];
 
-      for (size_t a : active) {
-        clades.at(a).add(id);
+      if (open.size()) {
+        open.back().add(id);
       }
     }
     prevtok = tok;
   }
+}
+
+void newick_to_clades(const std::string &s, TaxonSet &ts,
+                      std::unordered_set<Clade> &clade_set,
+                      CladeArena *arena) {
+  visit_clades(s, ts, arena, [&clade_set](Clade &c, size_t) {
+    clade_set.insert(std::move(c));
+  });
+}
+
+void newick_to_clades(const std::string &s, TaxonSet &ts,
+                      std::vector<Clade> &clades, CladeArena *arena) {
+  size_t base = clades.size();
+  std::vector<size_t> order;
+  visit_clades(s, ts, arena, [&](Clade &c, size_t n) {
+    clades.push_back(std::move(c));
+    order.push_back(n);
+  });
+  // Move each clade from its place children first to its place in
+  // preorder, a cycle at a time.
+  for (size_t i = 0; i < order.size(); i++) {
+    while (order[i] != i) {
+      std::swap(clades[base + i], clades[base + order[i]]);
+      std::swap(order[i], order[order[i]]);
+    }
+  }
+}
+
+void newick_to_clades(const std::string &s, TaxonSet &ts, CladeSet &clade_set,
+                      CladeArena *arena) {
+  visit_clades(s, ts, arena,
+               [&clade_set](Clade &c, size_t) { clade_set.insert(c); });
+}
+
+void newick_to_clades(const std::string &s, TaxonSet &ts,
+                      CladeInterner &interner, std::vector<uint32_t> &ids) {
+  size_t base = ids.size();
+  visit_clades(s, ts, NULL, [&](Clade &c, size_t n) {
+    if (ids.size() <= base + n) {
+      ids.resize(base + n + 1);
+    }
+    ids[base + n] = interner.intern(c);
+  });
+}
+
+void newick_to_splits(const std::string &s, TaxonSet &ts,
+                      std::unordered_set<Split> &splits, CladeArena *arena) {
+  std::vector<Clade> clades;
+  newick_to_clades(s, ts, clades, arena);
+  if (clades.empty()) {
+    return;
+  }
+  Clade taxa(clades[0]);
+  int ntaxa = taxa.size();
   for (Clade &c : clades) {
-    clade_set.insert(c);
+    Split split(std::move(c), taxa);
+    if (!split.trivial(ntaxa)) {
+      splits.insert(std::move(split));
+    }
   }
 }
 
-Tree newick_to_treeclades(const std::string &s, TaxonSet &ts) {
+// Reads s into a Tree without computing its clades. visit hears of the
+// nodes as they are read: open() for each internal node, leaf(n, taxon) and
+// close(n) once node n has all its children.
+template <class Visit>
+static Tree parse_tree(const std::string &s, TaxonSet &ts, CladeArena *arena,
+                       Visit &visit) {
   typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
   boost::char_separator<char> sep(";\n", "():,");
 
   tokenizer tokens(s, sep);
 
   std::vector<size_t> active;
-  std::vector<std::vector<size_t>> children;
 
-  Tree tree(ts);
+  Tree tree(ts, arena);
+  // The node a following ":length" belongs to.
+  int last = -1;
 
   std::string prevtok = "";
 
@@ -119,15 +223,22 @@ Tree newick_to_treeclades(const std::string &s, TaxonSet &ts) {
       int ind = tree.addNode();
 
       if (active.size()) {
-        tree.node(active.back()).addChild(ind);
+        tree.addChild(active.back(), ind);
       }
       active.push_back(ind);
+      visit.open();
     } else if (tok == ")") {
+      last = active.back();
       active.pop_back();
+      visit.close(last);
     } else if (tok == ":") {
     } else if (tok == ",") {
     } else {
-      if (prevtok == ")" || prevtok == ":" || (tok == " " && prevtok == ",")) {
+      if (prevtok == ":") {
+        tree.set_length(last, atof(tok.c_str()));
+        continue;
+      }
+      if (prevtok == ")" || (tok == " " && prevtok == ",")) {
         continue;
       }
       boost::algorithm::trim(tok);
@@ -136,19 +247,80 @@ Tree newick_to_treeclades(const std::string &s, TaxonSet &ts) {
       int ind = tree.addNode();
 
       if (active.size()) {
-        tree.node(active.back()).addChild(ind);
-      }
-      tree.node(ind).add(id);
-
-      for (size_t a : active) {
-        tree.node(a).add(id);
+        tree.addChild(active.back(), ind);
       }
+      tree.set_taxon(ind, id);
+      visit.leaf(ind, id);
+      last = ind;
     }
     prevtok = tok;
   }
   return tree;
 }
 
+namespace {
+
+struct NoVisit {
+  void open() {}
+  void leaf(int, Taxon) {}
+  void close(int) {}
+};
+
+// Interns the clade of each node as parse_tree finishes it, like
+// visit_clades, so the tree's own clades are never built.
+struct InternVisit {
+  TaxonSet &ts;
+  CladeInterner &interner;
+  std::vector<uint32_t> &ids;
+  // The clades of the internal nodes still open, and a scratch clade for
+  // the leaves.
+  std::vector<Clade> open_clades;
+  Clade leaf_clade;
+
+  InternVisit(TaxonSet &ts, CladeInterner &interner,
+              std::vector<uint32_t> &ids)
+      : ts(ts), interner(interner), ids(ids), leaf_clade(ts) {}
+
+  void open() { open_clades.emplace_back(ts); }
+  void leaf(int n, Taxon t) {
+    if (open_clades.size()) {
+      open_clades.back().add(t);
+    }
+    leaf_clade.add(t);
+    set(n, interner.intern(leaf_clade));
+    leaf_clade.remove(t);
+  }
+  void close(int n) {
+    if (open_clades.size() > 1) {
+      open_clades[open_clades.size() - 2] += open_clades.back();
+    }
+    set(n, interner.intern(open_clades.back()));
+    open_clades.pop_back();
+  }
+  void set(int n, uint32_t id) {
+    if (ids.size() <= (size_t) n) {
+      ids.resize(n + 1);
+    }
+    ids[n] = id;
+  }
+};
+
+}  // namespace
+
+Tree newick_to_treeclades(const std::string &s, TaxonSet &ts,
+                          CladeArena *arena) {
+  NoVisit visit;
+  return parse_tree(s, ts, arena, visit);
+}
+
+Tree newick_to_treeclades(const std::string &s, TaxonSet &ts,
+                          CladeInterner &interner, std::vector<uint32_t> &ids,
+                          CladeArena *arena) {
+  ids.clear();
+  InternVisit visit(ts, interner, ids);
+  return parse_tree(s, ts, arena, visit);
+}
+
 void newick_to_postorder(const std::string &s, TaxonSet &ts,
                          std::vector<Taxon> &order) {
   typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
@@ -326,7 +498,7 @@ std::string unmap_newick_names(const std::string &s, TaxonSet &ts) {
       std::stringstream ss(tok);
       int i;
       ss >> i;
-      const std::string &id = ts[i];
+      TaxonName id = ts[i];
       output << id;
     }
     prevtok = tok;
@@ -360,7 +532,7 @@ std::string unmap_clade_names(const std::string &s, TaxonSet &ts) {
       std::stringstream ss(tok);
       int i;
       ss >> i;
-      const std::string &id = ts[i];
+      TaxonName id = ts[i];
       output << id;
     }
     prevtok = tok;
@@ -8,20 +8,51 @@
 #include <iostream>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "Clade.hpp"
+#include "CladeInterner.hpp"
+#include "CladeSet.hpp"
 #include "TaxonSet.hpp"
 #include "TreeClade.hpp"
 
 typedef boost::multi_array<double, 2> dm_type;
 
 int newick_to_ts(const std::string& s, std::unordered_set<std::string>& taxa);
+// Adds the leaf names of s to ts and returns how many leaves s has. Threads
+// can read different trees into one concurrent TaxonSet this way before the
+// set is canonicalized; see TaxonSet::make_concurrent.
+int newick_to_ts(const std::string& s, TaxonSet& ts);
 
 Clade newick_to_taxa(const std::string& s, TaxonSet& ts);
 
+// With an arena, the bitsets of the parsed clades are allocated from it, and
+// it has to outlive the clades.
 void newick_to_clades(const std::string& s, TaxonSet& ts,
-                      std::unordered_set<Clade>& clade_set);
-Tree newick_to_treeclades(const std::string& s, TaxonSet& ts);
+                      std::unordered_set<Clade>& clade_set,
+                      CladeArena* arena = NULL);
+// Appends the clades of the internal nodes in preorder from the root.
+void newick_to_clades(const std::string& s, TaxonSet& ts,
+                      std::vector<Clade>& clades, CladeArena* arena = NULL);
+// Adds the clades to clade_set; call clade_set.build() once all trees are
+// in.
+void newick_to_clades(const std::string& s, TaxonSet& ts, CladeSet& clade_set,
+                      CladeArena* arena = NULL);
+// Interns the clades and appends their ids to ids, in preorder from the
+// root.
+void newick_to_clades(const std::string& s, TaxonSet& ts,
+                      CladeInterner& interner, std::vector<uint32_t>& ids);
+// The non-trivial splits of the tree, with the tree read as unrooted.
+void newick_to_splits(const std::string& s, TaxonSet& ts,
+                      std::unordered_set<Split>& splits,
+                      CladeArena* arena = NULL);
+Tree newick_to_treeclades(const std::string& s, TaxonSet& ts,
+                          CladeArena* arena = NULL);
+// Also interns the clade of every node, leaves included; ids[n] is the id
+// of the clade of node n.
+Tree newick_to_treeclades(const std::string& s, TaxonSet& ts,
+                          CladeInterner& interner, std::vector<uint32_t>& ids,
+                          CladeArena* arena = NULL);
 void newick_to_postorder(const std::string& s, TaxonSet& ts,
                          std::vector<Taxon>& order);
 
@@ -0,0 +1,243 @@
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include "catch2.hpp"
+#include "phylokit/Clade.hpp"
+#include "phylokit/newick.hpp"
+#include "test/fixtures.hpp"
+
+// Every heap allocation made by this test binary goes through here, so a
+// test can check how many allocations a block of code performs.
+static size_t allocations = 0;
+
+void *operator new(size_t sz) {
+  allocations++;
+  void *p = malloc(sz ? sz : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+namespace {
+// Taxon sets wider than the inline storage of BitVectorFixed, so that every
+// clade owns a heap buffer.
+const int ntaxa = 1000;
+
+Tree parse_and_return(const std::string &newick, TaxonSet &ts) {
+  Tree tree = newick_to_treeclades(newick, ts);
+  return tree;
+}
+}  // namespace
+
+TEST_CASE("Moving bitsets and clades does not allocate") {
+  TaxonSet ts(taxa_list(ntaxa));
+  Clade a(ts, "t1,t500,t999");
+  Clade b(ts, "t2");
+
+  size_t before = allocations;
+  Clade moved(std::move(a));
+  Clade sum = std::move(moved) + b;
+  Clade diff = std::move(sum) - ts["t2"];
+  Clade other(ts);
+  size_t after_ctor = allocations;
+  other = std::move(diff);
+  BitVectorFixed bits = other.get_taxa();
+  size_t after_copy = allocations;
+  BitVectorFixed bits2 = (std::move(bits) | b.get_taxa()) & ts.taxa_bs;
+  BitVectorFixed bits3 = (~std::move(bits2) & ts.taxa_bs) - b.get_taxa();
+
+  REQUIRE(after_ctor - before == 1);
+  REQUIRE(allocations == after_copy);
+  REQUIRE(other == Clade(ts, "t1,t500,t999"));
+  REQUIRE(bits3.popcount() == ntaxa - 4);
+}
+
+TEST_CASE("Parsing a tree and returning it only allocates while parsing") {
+  TaxonSet ts(taxa_list(ntaxa));
+  std::string newick = caterpillar(ntaxa);
+
+  size_t before = allocations;
+  Tree parsed = newick_to_treeclades(newick, ts);
+  size_t parse_allocations = allocations - before;
+
+  before = allocations;
+  Tree returned = parse_and_return(newick, ts);
+  REQUIRE(allocations - before == parse_allocations);
+
+  before = allocations;
+  Tree moved(std::move(returned));
+  REQUIRE(allocations == before);
+
+  REQUIRE(moved.root() == parsed.root());
+  REQUIRE(moved.root().verify());
+  for (int i = 0; i < moved.size(); i++) {
+    REQUIRE(moved.node(i).tree == &moved);
+  }
+}
+
+TEST_CASE("Trees compute their clades only when asked") {
+  TaxonSet ts(taxa_list(ntaxa));
+  std::string newick = caterpillar(ntaxa);
+
+  // The links of the 2 * ntaxa - 1 nodes take a few growing arrays, where
+  // a bitset per node would take an allocation each.
+  size_t before = allocations;
+  Tree tree = newick_to_treeclades(newick, ts);
+  REQUIRE(allocations - before < ntaxa / 4);
+  REQUIRE_FALSE(tree.has_clades());
+
+  DistanceMatrix lca(ts);
+  before = allocations;
+  tree.LCA(lca);
+  tree.leaf_order();
+  REQUIRE(allocations - before < ntaxa / 4);
+  REQUIRE_FALSE(tree.has_clades());
+
+  REQUIRE(tree.root().size() == ntaxa);
+  REQUIRE(tree.has_clades());
+  REQUIRE(tree.root().verify());
+}
+
+TEST_CASE("Moving a TaxonSet does not copy its names") {
+  TaxonSet ts(taxa_list(ntaxa));
+  size_t before = allocations;
+  TaxonSet moved(std::move(ts));
+  REQUIRE(allocations == before);
+  REQUIRE(moved.size() == ntaxa);
+  REQUIRE(moved["t10"] == moved["t10"]);
+}
+
+TEST_CASE("Clades parsed into an arena share its slabs") {
+  TaxonSet ts(taxa_list(ntaxa));
+  std::string newick = caterpillar(ntaxa);
+
+  size_t before = allocations;
+  Tree heap = newick_to_treeclades(newick, ts);
+  heap.root();
+  size_t heap_allocations = allocations - before;
+
+  CladeArena arena;
+  before = allocations;
+  Tree slab = newick_to_treeclades(newick, ts, &arena);
+  slab.root();
+  size_t arena_allocations = allocations - before;
+
+  // Every node's words come from the arena, which allocates each slab and at
+  // most as often again to grow its list of slabs.
+  size_t slabs = arena.bytes_reserved() / CladeArena::default_slab_bytes;
+  REQUIRE(slabs > 0);
+  REQUIRE(arena_allocations + heap.size() <=
+          heap_allocations + 2 * slabs);
+  REQUIRE(slab.root() == heap.root());
+  REQUIRE(slab.root().verify());
+
+  std::unordered_set<Clade> heap_set, arena_set;
+  newick_to_clades(newick, ts, heap_set);
+  newick_to_clades(newick, ts, arena_set, &arena);
+  REQUIRE(heap_set == arena_set);
+}
+
+TEST_CASE("Mixing sparse and dense bitsets keeps their arena") {
+  const size_t wide = 2 * BitVectorFixed::sparse_min_bits;
+  CladeArena arena;
+  auto sparse = [&]() {
+    BitVectorFixed bits(wide, &arena);
+    bits.set(1);
+    bits.set(3);
+    bits.set(wide - 1);
+    return bits;
+  };
+  BitVectorFixed dense(wide, &arena);
+  for (size_t i = 0; i < wide; i += 3) {
+    dense.set(i);
+  }
+
+  // The first round warms the scratch buffers and the word kernels.
+  for (int round = 0; round < 2; round++) {
+    size_t before = allocations;
+    BitVectorFixed ors = sparse(), xors = sparse(), ands(dense, &arena);
+    bool sparse_before = ors.is_sparse() && !ands.is_sparse();
+    ors |= dense;
+    xors ^= dense;
+    ands &= sparse();
+    bool sparse_after = !ors.is_sparse() && ands.is_sparse();
+    // Growing the sparse result back into words also stays in the arena.
+    for (size_t i = 0; i < wide; i += 2) {
+      ands.set(i);
+    }
+    size_t used = allocations - before;
+
+    REQUIRE(sparse_before);
+    REQUIRE(sparse_after);
+    REQUIRE_FALSE(ands.is_sparse());
+    REQUIRE(ors.popcount() == dense.popcount() + 2);
+    REQUIRE(xors.popcount() == dense.popcount() + 1);
+    REQUIRE(ands.popcount() == (int) (wide / 2 + 1));
+    if (round) {
+      REQUIRE(used == 0);
+    }
+  }
+}
+
+TEST_CASE("Combining sparse bitsets reuses a scratch buffer") {
+  const size_t wide = 2 * BitVectorFixed::sparse_min_bits;
+  CladeArena arena;
+  BitVectorFixed a(wide, &arena), b(wide, &arena);
+  for (size_t i = 0; i < 20; i++) {
+    a.set(3 * i);
+    b.set(5 * i);
+  }
+
+  // The first round warms the scratch buffers.
+  for (int round = 0; round < 2; round++) {
+    size_t before = allocations;
+    BitVectorFixed both(a, &arena), either(a, &arena);
+    both |= b;
+    either ^= b;
+    size_t used = allocations - before;
+
+    REQUIRE(both.is_sparse());
+    REQUIRE(either.is_sparse());
+    // 0, 15, 30, 45 are in both.
+    REQUIRE(both.popcount() == 36);
+    REQUIRE(either.popcount() == 32);
+    if (round) {
+      REQUIRE(used == 0);
+    }
+  }
+}
+
+TEST_CASE("Lazy set algebra does not allocate") {
+  TaxonSet ts(taxa_list(ntaxa));
+  Clade a(ts, "t1,t500,t999");
+  Clade b(ts, "t2,t500");
+  Clade c(ts);
+
+  size_t before = allocations;
+  int n = ((lazy(a) - b) | ts.taxa_bs).popcount();
+  bool overlap = (lazy(a) & b).any();
+  c = lazy(a) ^ b;
+  c = lazy(c) - a;
+  REQUIRE(allocations == before);
+
+  REQUIRE(n == ntaxa);
+  REQUIRE(overlap);
+  REQUIRE(c == Clade(ts, "t2"));
+}
+
+TEST_CASE("Looking up taxa does not allocate") {
+  TaxonSet ts(taxa_list(ntaxa));
+  std::string name = "t500";
+  for (int frozen = 0; frozen < 2; frozen++) {
+    size_t before = allocations;
+    Taxon t = ts[name];
+    Taxon u = ts.find(name.data(), name.size());
+    REQUIRE(allocations == before);
+    REQUIRE(t == u);
+    REQUIRE(ts[t] == name);
+    ts.freeze();
+  }
+}
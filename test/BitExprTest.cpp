@@ -0,0 +1,84 @@
+#include <random>
+#include <string>
+#include "catch2.hpp"
+#include "phylokit/Clade.hpp"
+#include "test/fixtures.hpp"
+
+namespace {
+BitVectorFixed random_bits(size_t n, double p, std::mt19937 &rng) {
+  std::bernoulli_distribution in(p);
+  BitVectorFixed bits(n);
+  for (size_t i = 0; i < n; i++) {
+    if (in(rng)) bits.set(i);
+  }
+  return bits;
+}
+}  // namespace
+
+TEST_CASE("Lazy expressions agree with the eager operators") {
+  std::mt19937 rng(7);
+  // Dense and sparse operands, and both forms of result.
+  for (size_t n : {10, 64, 300, 5000, 100000}) {
+    for (double p : {0.001, 0.3}) {
+      BitVectorFixed a = random_bits(n, p, rng);
+      BitVectorFixed b = random_bits(n, 0.3, rng);
+      BitVectorFixed c = random_bits(n, p, rng);
+
+      BitVectorFixed eager = ((a - b) | c) & ~(a ^ b);
+      BitVectorFixed lazy_bits(n);
+      lazy_bits = ((lazy(a) - b) | c) & ~(lazy(a) ^ b);
+      REQUIRE(lazy_bits == eager);
+      REQUIRE(lazy_bits.popcount() == eager.popcount());
+      REQUIRE(lazy_bits.hash() == eager.hash());
+
+      REQUIRE(((lazy(a) - b) | c).popcount() == ((a - b) | c).popcount());
+      REQUIRE((lazy(a) & c).hash() == (a & c).hash());
+      REQUIRE((lazy(a) & c).any() == ((a & c).popcount() > 0));
+      REQUIRE((lazy(a) | b) == (a | b));
+      REQUIRE((lazy(a) | b) != (a & b));
+    }
+  }
+}
+
+TEST_CASE("An operand can be assigned the expression") {
+  std::mt19937 rng(11);
+  for (size_t n : {300, 100000}) {
+    BitVectorFixed a = random_bits(n, 0.01, rng);
+    BitVectorFixed b = random_bits(n, 0.01, rng);
+    BitVectorFixed expected = a - b;
+    a = lazy(a) - b;
+    REQUIRE(a == expected);
+    expected = b | a;
+    b = lazy(b) | a;
+    REQUIRE(b == expected);
+  }
+}
+
+TEST_CASE("Lazy complements stop at the size") {
+  for (size_t n : {10, 64, 300}) {
+    BitVectorFixed a(n);
+    a.set(3);
+    REQUIRE((~lazy(a)).popcount() == (int) n - 1);
+    REQUIRE(!(~lazy(a) & a).any());
+    BitVectorFixed all(n);
+    all = ~lazy(all);
+    REQUIRE(all.popcount() == (int) n);
+  }
+}
+
+TEST_CASE("Clades are operands of lazy expressions") {
+  TaxonSet ts = make_taxa(100);
+  Clade a(ts, "t1,t2,t3,t50");
+  Clade b(ts, "t2,t50,t60");
+  REQUIRE(Clade(ts, lazy(a) - b) == a.minus(b));
+  REQUIRE(Clade(ts, lazy(a) & b) == a.overlap(b));
+  REQUIRE((lazy(a) & b).popcount() == a.overlap_size(b));
+  REQUIRE(Clade(ts, lazy(a) | b).hash() == a.plus(b).hash());
+  REQUIRE(a.complement() == Clade(ts, lazy(ts.taxa_bs) - a));
+  REQUIRE(a.complement().size() == 96);
+  a = lazy(a) - b;
+  REQUIRE(a == Clade(ts, "t1,t3"));
+  // Plain clades still use the eager operators.
+  Clade c = a - b;
+  REQUIRE(c == a);
+}
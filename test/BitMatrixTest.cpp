@@ -0,0 +1,64 @@
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/BitMatrix.hpp"
+#include "phylokit/newick.hpp"
+#include "test/fixtures.hpp"
+
+TEST_CASE("BitMatrix rows are cache aligned copies of the clades") {
+  for (int n : {5, 64, 600, 5000}) {
+    TaxonSet ts(taxa_list(n));
+    std::unordered_set<Clade> clades;
+    newick_to_clades(balanced(0, n) + ";", ts, clades);
+    BitMatrix m(ts, clades);
+    REQUIRE(m.rows() == clades.size());
+    REQUIRE(m.stride() % 8 == 0);
+    for (size_t r = 0; r < m.rows(); r++) {
+      REQUIRE(reinterpret_cast<uintptr_t>(m.row_words(r)) % 64 == 0);
+      REQUIRE(clades.count(m.row(r)));
+    }
+  }
+}
+
+TEST_CASE("BitMatrix batch queries agree with Clade") {
+  for (int n : {5, 64, 600, 5000}) {
+    TaxonSet ts(taxa_list(n));
+    Tree tree = newick_to_treeclades(balanced(0, n) + ";", ts);
+    BitMatrix m(tree);
+    REQUIRE(m.rows() == (size_t) tree.size());
+
+    Clade query(ts);
+    for (int i = 0; i < n / 2 + 1; i++) {
+      query.add(ts["t" + std::to_string(i)]);
+    }
+    std::vector<Clade> queries = {query, tree.node(1), Clade(ts)};
+
+    std::vector<int> pop = m.popcounts();
+    for (int i = 0; i < tree.size(); i++) {
+      REQUIRE(pop[i] == tree.node(i).size());
+    }
+    for (const Clade &q : queries) {
+      std::vector<int> overlap = m.overlap_sizes(q);
+      std::vector<SetRelation> rel = m.relations(q);
+      clade_bitset sub = m.subsets_of(q);
+      clade_bitset super = m.supersets_of(q);
+      clade_bitset compat = m.compatible_with(q);
+      for (int i = 0; i < tree.size(); i++) {
+        const TreeClade &c = tree.node(i);
+        REQUIRE(overlap[i] == c.overlap_size(q));
+        REQUIRE(rel[i] == c.relation(q));
+        REQUIRE(sub.get(i) == q.contains(c));
+        REQUIRE(super.get(i) == c.contains(q));
+        REQUIRE(compat.get(i) == c.compatible(q));
+      }
+    }
+
+    Taxon t = ts["t1"];
+    clade_bitset col = m.column(t);
+    for (int i = 0; i < tree.size(); i++) {
+      REQUIRE(col.get(i) == tree.node(i).contains(t));
+      REQUIRE(m.get(i, t) == tree.node(i).contains(t));
+    }
+  }
+}
@@ -1,5 +1,9 @@
 #include "catch2.hpp"
+#include <vector>
+#include "phylokit/BitSimd.hpp"
 #include "phylokit/BitVector.hpp"
+#include "phylokit/CladeArena.hpp"
+#include "phylokit/RankSelect.hpp"
 
 TEST_CASE("BitVector created with size has all bits zero") {
   size_t sz = 5000;
@@ -102,4 +106,338 @@ TEST_CASE("BitVector hash comparison equal bitvectors") {
   bvf1.set(434);
   bvf2.set(5);
   REQUIRE(bvf1.hash() == bvf2.hash());
-}
\ No newline at end of file
+}
+
+TEST_CASE("BitVector small bitvectors use inline storage") {
+  BitVectorFixed small(BitVectorFixed::inline_bits);
+  BitVectorFixed large(BitVectorFixed::inline_bits + 1);
+  REQUIRE(small.is_inline());
+  REQUIRE(!large.is_inline());
+}
+
+TEST_CASE("BitVector swap between inline and heap storage") {
+  BitVectorFixed small(100);
+  BitVectorFixed large(1000);
+  small.set(7);
+  large.set(432);
+  swap(small, large);
+  REQUIRE(small.size == 1000);
+  REQUIRE(small.get(432));
+  REQUIRE(!small.is_inline());
+  REQUIRE(large.size == 100);
+  REQUIRE(large.get(7));
+  REQUIRE(large.is_inline());
+}
+
+TEST_CASE("BitVector assignment across storage sizes") {
+  BitVectorFixed small(100);
+  BitVectorFixed large(1000);
+  large.set(999);
+  small = large;
+  REQUIRE(small == large);
+  REQUIRE(!small.is_inline());
+  BitVectorFixed other(50);
+  other.set(3);
+  small = other;
+  REQUIRE(small == other);
+  REQUIRE(small.is_inline());
+}
+
+TEST_CASE("BitVector operations agree across word widths") {
+  for (size_t sz : {1, 63, 64, 65, 200, 256, 1000, 1024, 1025, 5000}) {
+    BitVectorFixed a(sz);
+    BitVectorFixed b(sz);
+    int both = 0, either = 0, only_a = 0;
+    for (size_t i = 0; i < sz; i++) {
+      bool in_a = i % 3 == 0, in_b = i % 5 == 0;
+      if (in_a) a.set(i);
+      if (in_b) b.set(i);
+      both += in_a && in_b;
+      either += in_a || in_b;
+      only_a += in_a && !in_b;
+    }
+    REQUIRE(a.overlap_size(b) == both);
+    REQUIRE((a & b).popcount() == both);
+    REQUIRE((a | b).popcount() == either);
+    REQUIRE((a ^ b).popcount() == either - both);
+    REQUIRE((a & ~b).popcount() == only_a);
+    BitVectorFixed c(a);
+    c |= b;
+    REQUIRE(c == (a | b));
+    c &= b;
+    REQUIRE(c == b);
+    c ^= b;
+    REQUIRE(c.popcount() == 0);
+  }
+}
+
+TEST_CASE("BitVector SIMD kernels agree with scalar kernels") {
+  std::vector<const BitSimdKernels *> kernels = supported_bit_simd_kernels();
+  REQUIRE(std::string(kernels.front()->name) == "scalar");
+  for (size_t words : {1, 3, 4, 17, 63, 64, 65, 157, 1000}) {
+    std::vector<elem_type> a(words), b(words), out(words), expected(words);
+    elem_type x = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < words; i++) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      a[i] = x;
+      b[i] = x * 0xbf58476d1ce4e5b9ULL;
+    }
+    for (const BitSimdKernels *k : kernels) {
+      INFO(k->name << " on " << words << " words");
+      REQUIRE(k->popcount(a.data(), words) ==
+              BitWords<0>::popcount(a.data(), words));
+      REQUIRE(k->overlap_size(a.data(), b.data(), words) ==
+              BitWords<0>::overlap_size(a.data(), b.data(), words));
+      REQUIRE(k->equal(a.data(), a.data(), words));
+      REQUIRE(!k->equal(a.data(), b.data(), words));
+      k->and_(out.data(), a.data(), b.data(), words);
+      BitWords<0>::and_(expected.data(), a.data(), b.data(), words);
+      REQUIRE(out == expected);
+      k->or_(out.data(), a.data(), b.data(), words);
+      BitWords<0>::or_(expected.data(), a.data(), b.data(), words);
+      REQUIRE(out == expected);
+      k->xor_(out.data(), a.data(), b.data(), words);
+      BitWords<0>::xor_(expected.data(), a.data(), b.data(), words);
+      REQUIRE(out == expected);
+    }
+  }
+}
+
+TEST_CASE("BitVector set relations") {
+  for (size_t sz : {100, 5000}) {
+    BitVectorFixed small(sz), big(sz), other(sz), empty(sz);
+    small.set(3);
+    small.set(sz - 1);
+    big.set(3);
+    big.set(50);
+    big.set(sz - 1);
+    other.set(50);
+    other.set(60);
+
+    REQUIRE(small.is_subset_of(big));
+    REQUIRE(!big.is_subset_of(small));
+    REQUIRE(empty.is_subset_of(small));
+    REQUIRE(small.is_disjoint(other));
+    REQUIRE(!big.is_disjoint(other));
+    REQUIRE(big.intersects(other));
+    REQUIRE(big.and_not_count(small) == 1);
+    REQUIRE(big.and_not_count(other) == 2);
+    REQUIRE((big - small).popcount() == 1);
+
+    REQUIRE(small.relation(big) == SUBSET);
+    REQUIRE(big.relation(small) == SUPERSET);
+    REQUIRE(big.relation(big) == EQUAL);
+    REQUIRE(small.relation(other) == DISJOINT);
+    REQUIRE(big.relation(other) == CROSSING);
+    REQUIRE(empty.relation(small) == SUBSET);
+  }
+}
+
+TEST_CASE("BitVector hash is maintained through set and unset") {
+  for (size_t sz : {100, 5000}) {
+    BitVectorFixed incremental(sz);
+    incremental.hash();
+    for (size_t i = 0; i < sz; i += 7) {
+      incremental.set(i);
+    }
+    incremental.unset(14);
+    incremental.set(14);
+    incremental.unset(21);
+
+    BitVectorFixed bulk(sz);
+    for (size_t i = 0; i < sz; i += 7) {
+      bulk.set(i);
+    }
+    BitVectorFixed rebuilt = bulk | BitVectorFixed(sz);
+    rebuilt.unset(21);
+    REQUIRE(incremental == rebuilt);
+    REQUIRE(incremental.hash() == rebuilt.hash());
+  }
+}
+
+TEST_CASE("BitVector hash separates shifted bit patterns") {
+  size_t sz = 5000;
+  BitVectorFixed a(sz), b(sz), c(sz);
+  a.set(0);
+  a.set(64);
+  b.set(1);
+  b.set(65);
+  c.set(64);
+  c.set(0);
+  REQUIRE(a.hash() != b.hash());
+  REQUIRE(a.hash() == c.hash());
+  REQUIRE(a.hash() != BitVectorFixed(sz).hash());
+}
+
+TEST_CASE("BitVector iteration visits set bits in order") {
+  for (size_t sz : {1, 64, 100, 5000}) {
+    BitVectorFixed bvf(sz);
+    std::vector<int> expected;
+    for (size_t i = 0; i < sz; i += 1 + i / 3) {
+      bvf.set(i);
+      expected.push_back(i);
+    }
+    bvf.set(sz - 1);
+    if (expected.back() != (int) sz - 1) expected.push_back(sz - 1);
+
+    std::vector<int> seen;
+    for (int i : bvf) {
+      seen.push_back(i);
+    }
+    REQUIRE(seen == expected);
+  }
+  std::vector<int> none;
+  for (int i : BitVectorFixed(5000)) {
+    none.push_back(i);
+  }
+  REQUIRE(none.empty());
+}
+
+TEST_CASE("BitVector wide sets with few members are stored sparsely") {
+  size_t sz = 100000;
+  BitVectorFixed bvf(sz);
+  REQUIRE(bvf.is_sparse());
+  REQUIRE(bvf.is_inline());
+  bvf.set(99999);
+  bvf.set(5);
+  bvf.set(70);
+  REQUIRE(bvf.popcount() == 3);
+  REQUIRE(bvf.ffs() == 5);
+  REQUIRE(bvf.word(1) == (elem_type) 1 << 6);
+  REQUIRE(bvf.get(70));
+  REQUIRE(!bvf.get(71));
+
+  // Once the members need more than half the space of the words, the bit
+  // vector switches to words.
+  for (size_t i = 0; i < sz && bvf.is_sparse(); i += 3) {
+    bvf.set(i);
+  }
+  REQUIRE(!bvf.is_sparse());
+  REQUIRE(bvf.get(5));
+  REQUIRE(bvf.get(99999));
+  REQUIRE((size_t) bvf.popcount() == (sz + 63) / 64 + 1);
+}
+
+TEST_CASE("BitVector sparse and dense forms agree") {
+  size_t sz = 20000;
+  std::vector<BitVectorFixed> sparse, dense;
+  elem_type x = 0x9e3779b97f4a7c15ULL;
+  for (int n : {0, 3, 40, 300, 2000}) {
+    BitVectorFixed bvf(sz);
+    for (int i = 0; i < n; i++) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      bvf.set(x % (n < 100 ? 500 : sz));
+    }
+    bvf.set(17);
+    sparse.push_back(bvf);
+    dense.push_back(~~bvf);
+    REQUIRE(!dense.back().is_sparse());
+  }
+  REQUIRE(sparse[0].is_sparse());
+  REQUIRE(!sparse.back().is_sparse());
+
+  for (size_t i = 0; i < sparse.size(); i++) {
+    REQUIRE(sparse[i] == dense[i]);
+    REQUIRE(sparse[i].hash() == dense[i].hash());
+    REQUIRE(sparse[i].str() == dense[i].str());
+    std::vector<int> a, b;
+    for (int t : sparse[i]) a.push_back(t);
+    for (int t : dense[i]) b.push_back(t);
+    REQUIRE(a == b);
+    std::vector<elem_type> words((sz + 63) / 64);
+    sparse[i].copy_words(words.data());
+    BitVectorFixed from_words(sz);
+    from_words.assign_words(words.data());
+    REQUIRE(from_words == dense[i]);
+    REQUIRE(from_words.hash() == dense[i].hash());
+    for (size_t j = 0; j < sparse.size(); j++) {
+      const BitVectorFixed &s1 = sparse[i], &s2 = sparse[j];
+      const BitVectorFixed &d1 = dense[i], &d2 = dense[j];
+      for (const BitVectorFixed *o : {&s2, &d2}) {
+        INFO(i << " against " << j);
+        REQUIRE(s1.overlap_size(*o) == d1.overlap_size(d2));
+        REQUIRE(s1.is_subset_of(*o) == d1.is_subset_of(d2));
+        REQUIRE(d1.is_subset_of(*o) == d1.is_subset_of(d2));
+        REQUIRE(s1.intersects(*o) == d1.intersects(d2));
+        REQUIRE(s1.and_not_count(*o) == d1.and_not_count(d2));
+        REQUIRE(s1.relation(*o) == d1.relation(d2));
+        REQUIRE(d1.relation(*o) == d1.relation(d2));
+        REQUIRE((s1 == *o) == (d1 == d2));
+        REQUIRE((s1 & *o) == (d1 & d2));
+        REQUIRE((d1 & *o) == (d1 & d2));
+        REQUIRE((s1 | *o) == (d1 | d2));
+        REQUIRE((s1 ^ *o) == (d1 ^ d2));
+        REQUIRE((s1 - *o) == (d1 - d2));
+        REQUIRE((d1 - *o) == (d1 - d2));
+        REQUIRE((s1 | *o).hash() == (d1 | d2).hash());
+        BitVectorFixed c(s1);
+        c -= *o;
+        c |= *o;
+        REQUIRE(c == (d1 | d2));
+        REQUIRE(c.hash() == (d1 | d2).hash());
+      }
+    }
+    REQUIRE(~sparse[i] == ~dense[i]);
+  }
+}
+
+TEST_CASE("BitVector storage from an arena") {
+  CladeArena arena(1024);
+  for (size_t sz : {100, 1000, 100000}) {
+    BitVectorFixed bvf(sz, &arena);
+    BitVectorFixed heap(sz);
+    for (size_t i = 0; i < sz; i += 5) {
+      bvf.set(i);
+      heap.set(i);
+    }
+    REQUIRE(bvf == heap);
+    REQUIRE(bvf.hash() == heap.hash());
+
+    BitVectorFixed copy(bvf);
+    BitVectorFixed moved(std::move(bvf));
+    moved.unset(0);
+    REQUIRE(copy == heap);
+    REQUIRE(moved != heap);
+    moved = heap;
+    REQUIRE(moved == heap);
+    BitVectorFixed into_arena(heap, &arena);
+    REQUIRE(into_arena == heap);
+  }
+  REQUIRE(arena.bytes_allocated() > 0);
+  REQUIRE(arena.bytes_reserved() >= arena.bytes_allocated());
+  arena.clear();
+  REQUIRE(arena.bytes_reserved() == 0);
+}
+
+TEST_CASE("RankSelect agrees with a scan of the set bits") {
+  for (size_t sz : {1, 64, 100, 513, 5000, 100000}) {
+    for (int density : {1, 3, 50}) {
+      BitVectorFixed bvf(sz);
+      elem_type x = 0x9e3779b97f4a7c15ULL;
+      for (size_t i = 0; i < sz; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        if (x % density == 0) bvf.set(i);
+      }
+      INFO(sz << " bits, " << bvf.popcount() << " set, sparse "
+              << bvf.is_sparse());
+      RankSelect index(bvf);
+      REQUIRE(index.count() == bvf.popcount());
+      int rank = 0;
+      for (size_t i = 0; i < sz; i++) {
+        REQUIRE(index.rank(i) == rank);
+        if (bvf.get(i)) {
+          REQUIRE(index.select(rank) == (int) i);
+          rank++;
+        }
+      }
+      REQUIRE(index.rank(sz) == rank);
+      REQUIRE(index.select(rank) == -1);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/CladeInterner.hpp"
+#include "phylokit/newick.hpp"
+#include "test/fixtures.hpp"
+
+TEST_CASE("Interned ids are dense and stable") {
+  for (int n : {7, 300, 5003}) {
+    TaxonSet ts(taxa_list(n));
+    CladeInterner interner(ts);
+    std::vector<uint32_t> ids;
+    for (int step : {1, 2, 3, 1, 2}) {
+      newick_to_clades(caterpillar(n, step), ts, interner, ids);
+    }
+    std::unordered_set<Clade> clades;
+    for (int step : {1, 2, 3}) {
+      newick_to_clades(caterpillar(n, step), ts, clades);
+    }
+    REQUIRE(interner.size() == clades.size());
+    REQUIRE(ids.size() == 5 * (size_t) (n - 1));
+    for (size_t i = 0; i < interner.size(); i++) {
+      REQUIRE(interner.find(interner[i]) == (int) i);
+      REQUIRE(interner.intern(interner[i]) == i);
+    }
+    // The repeated trees get the ids of their first parse.
+    for (size_t i = 0; i < 2 * (size_t) (n - 1); i++) {
+      REQUIRE(ids[3 * (n - 1) + i] == ids[i]);
+    }
+    for (const Clade &c : clades) {
+      REQUIRE(interner.contains(c));
+      REQUIRE(interner[interner.find(c)] == c);
+    }
+    REQUIRE(interner.size() == clades.size());
+    REQUIRE(!interner.contains(Clade(ts)));
+  }
+}
+
+TEST_CASE("Tree nodes are interned by index") {
+  TaxonSet ts(taxa_list(6));
+  CladeInterner interner(ts);
+  std::vector<uint32_t> ids1, ids2;
+  Tree t1 = newick_to_treeclades("((t0,t1),(t2,(t3,(t4,t5))));", ts, interner,
+                                 ids1);
+  Tree t2 = newick_to_treeclades("((t1,t0),((t2,t3),(t4,t5)));", ts, interner,
+                                 ids2);
+  REQUIRE(ids1.size() == (size_t) t1.size());
+  REQUIRE(ids2.size() == (size_t) t2.size());
+  // The ids come from the parse, not from the trees' own clades.
+  REQUIRE_FALSE(t1.has_clades());
+  REQUIRE_FALSE(t2.has_clades());
+  for (int n = 0; n < t1.size(); n++) {
+    REQUIRE(interner[ids1[n]] == t1.node(n));
+  }
+  for (int n = 0; n < t2.size(); n++) {
+    REQUIRE(interner[ids2[n]] == t2.node(n));
+  }
+  // Six leaves, the root, (t0,t1), (t2,...,t5) and (t4,t5) are shared;
+  // (t3,t4,t5) and (t2,t3) are not.
+  REQUIRE(interner.size() == 6 + 4 + 2);
+  REQUIRE(ids1[0] == ids2[0]);
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/CladeSet.hpp"
+#include "phylokit/TreeGenerator.hpp"
+#include "phylokit/newick.hpp"
+#include "test/fixtures.hpp"
+
+namespace {
+// Gene trees of one species tree, which share many of their clades.
+std::vector<std::string> gene_trees(const TaxonSet &ts, int ntrees,
+                                    uint64_t seed) {
+  TreeGenerator gen(ts, seed);
+  SimTree species = gen.yule();
+  std::vector<std::string> trees(ntrees);
+  for (std::string &tree : trees) {
+    gen.write_newick(gen.coalescent(species), tree, false);
+  }
+  return trees;
+}
+}  // namespace
+
+TEST_CASE("Clade order is total and consistent with equality") {
+  for (int n : {10, 200, 5000}) {
+    TaxonSet ts(taxa_list(n));
+    std::unordered_set<Clade> set;
+    for (const std::string &tree : gene_trees(ts, 5, n)) {
+      newick_to_clades(tree, ts, set);
+    }
+    std::vector<Clade> clades(set.begin(), set.end());
+    clades.push_back(Clade(ts));
+    std::sort(clades.begin(), clades.end());
+    for (size_t i = 0; i + 1 < clades.size(); i++) {
+      REQUIRE(clades[i] < clades[i + 1]);
+      REQUIRE(!(clades[i + 1] < clades[i]));
+      REQUIRE(clades[i].compare(clades[i + 1]) < 0);
+    }
+    for (const Clade &c : clades) {
+      // The same clade in the dense form compares equal to the sparse form.
+      Clade dense(ts, ~~c.get_taxa());
+      REQUIRE(c.compare(dense) == 0);
+      REQUIRE(!(c < dense));
+    }
+    // The empty clade is the smallest.
+    REQUIRE(clades.front() == Clade(ts));
+  }
+}
+
+TEST_CASE("CladeSet deduplicates like an unordered_set") {
+  for (int n : {10, 200, 5000}) {
+    TaxonSet ts(taxa_list(n));
+    std::unordered_set<Clade> expected;
+    CladeSet clades(ts);
+    std::vector<std::string> trees = gene_trees(ts, n < 1000 ? 1000 : 20, 7);
+    for (const std::string &tree : trees) {
+      newick_to_clades(tree, ts, expected);
+      newick_to_clades(tree, ts, clades);
+    }
+    REQUIRE(!clades.built());
+    clades.build();
+    REQUIRE(clades.built());
+    REQUIRE(clades.size() == expected.size());
+    REQUIRE(std::is_sorted(clades.begin(), clades.end()));
+    for (size_t i = 0; i < clades.size(); i++) {
+      REQUIRE(expected.count(clades[i]));
+      REQUIRE(clades.find(clades[i]) == (int) i);
+    }
+
+    std::unordered_set<Clade> others;
+    for (const std::string &tree : gene_trees(ts, 5, 99)) {
+      newick_to_clades(tree, ts, others);
+    }
+    for (const Clade &c : others) {
+      REQUIRE(clades.contains(c) == (expected.count(c) > 0));
+    }
+    REQUIRE(!clades.contains(Clade(ts)));
+
+    CladeSet from_set(ts, expected);
+    REQUIRE(from_set.size() == clades.size());
+    for (size_t i = 0; i < clades.size(); i++) {
+      REQUIRE(from_set[i] == clades[i]);
+    }
+  }
+}
+
+TEST_CASE("CladeSet finds the sorted clades while the layout is stale") {
+  TaxonSet ts(200);
+  for (int i = 0; i < 100; i++) {
+    ts.add("t" + std::to_string(i));
+  }
+  CladeSet clades(ts);
+  REQUIRE(!clades.contains(Clade(ts, "t0,t1")));
+  for (const std::string &tree : gene_trees(ts, 100, 3)) {
+    newick_to_clades(tree, ts, clades);
+  }
+  clades.build();
+  size_t n = clades.size();
+  // Clades over the grown taxon set are wider, and insert() sorts the
+  // narrower ones in before buffering them, which drops the search layout.
+  for (int i = 100; i < 200; i++) {
+    ts.add("t" + std::to_string(i));
+  }
+  for (const std::string &tree : gene_trees(ts, 10, 4)) {
+    newick_to_clades(tree, ts, clades);
+  }
+  REQUIRE(!clades.built());
+  REQUIRE(clades.size() == n);
+  for (size_t i = 0; i < n; i++) {
+    REQUIRE(clades.find(clades[i]) == (int) i);
+  }
+  REQUIRE(!clades.contains(Clade(ts, "t0,t1")));
+  clades.build();
+  REQUIRE(clades.size() > n);
+  for (size_t i = 0; i < clades.size(); i++) {
+    REQUIRE(clades.find(clades[i]) == (int) i);
+  }
+}
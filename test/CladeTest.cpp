@@ -0,0 +1,47 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/Clade.hpp"
+#include "test/fixtures.hpp"
+
+TEST_CASE("Clade restrict_to and expand_to renumber through a RankSelect") {
+  for (int n : {10, 300, 6000}) {
+    TaxonSet ts(taxa_list(n));
+    Clade kept(ts), clade(ts);
+    for (int i = 0; i < n; i++) {
+      if (i % 3) kept.add(ts["t" + std::to_string(i)]);
+      if (i % 2) clade.add(ts["t" + std::to_string(i)]);
+    }
+    RankSelect index(kept.get_taxa());
+    TaxonSet compact = compact_taxon_set(kept);
+    REQUIRE(compact.size() == (size_t) kept.size());
+
+    Clade restricted = clade.restrict_to(compact, index);
+    REQUIRE(restricted.size() == clade.overlap_size(kept));
+    for (Taxon t : restricted) {
+      REQUIRE(clade.contains(ts[compact[t]]));
+      REQUIRE(kept.contains(ts[compact[t]]));
+    }
+    REQUIRE(restricted.expand_to(ts, index) == clade.overlap(kept));
+  }
+}
+
+TEST_CASE("Threads can hash a shared const clade") {
+  for (int n : {100, 6000}) {
+    TaxonSet ts(taxa_list(n));
+    Clade a(ts), b(ts);
+    for (int i = 0; i < n; i += 7) a.add(i);
+    for (int i = 0; i < n; i += 11) b.add(i);
+    // Built from an expression, so the hash is not cached yet.
+    const Clade shared(ts, lazy(a) | b);
+    size_t expected = Clade(ts, lazy(a) | b).hash();
+    std::vector<size_t> hashes(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < hashes.size(); i++) {
+      threads.emplace_back([&, i]() { hashes[i] = shared.hash(); });
+    }
+    for (std::thread &t : threads) t.join();
+    for (size_t h : hashes) REQUIRE(h == expected);
+  }
+}
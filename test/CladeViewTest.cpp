@@ -0,0 +1,92 @@
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/BitMatrix.hpp"
+#include "phylokit/CladeView.hpp"
+#include "phylokit/DistanceMatrix.hpp"
+#include "test/fixtures.hpp"
+
+TEST_CASE("Views of matrix rows agree with the clades") {
+  std::mt19937 rng(3);
+  for (int n : {10, 64, 300, 5000}) {
+    TaxonSet ts = make_taxa(n);
+    std::bernoulli_distribution in(0.3);
+    std::vector<Clade> clades;
+    BitMatrix m(ts);
+    for (int i = 0; i < 20; i++) {
+      Clade c(ts);
+      for (int t = 0; t < n; t++) {
+        if (in(rng)) c.add(t);
+      }
+      clades.push_back(c);
+      m.add(c);
+    }
+    for (size_t i = 0; i < clades.size(); i++) {
+      CladeView v = m.view(i);
+      REQUIRE(v.size() == clades[i].size());
+      REQUIRE(v.hash() == clades[i].hash());
+      REQUIRE(v.to_clade(ts) == clades[i]);
+      REQUIRE(v.contains(v));
+      REQUIRE(v == m.view(i));
+      std::vector<Taxon> taxa, expected;
+      for (Taxon t : v) taxa.push_back(t);
+      for (Taxon t : clades[i]) expected.push_back(t);
+      REQUIRE(taxa == expected);
+      for (size_t j = 0; j < clades.size(); j++) {
+        CladeView w = m.view(j);
+        REQUIRE(v.overlap_size(w) == clades[i].overlap_size(clades[j]));
+        REQUIRE(v.relation(w) == clades[i].relation(clades[j]));
+        REQUIRE(v.contains(w) == clades[i].contains(clades[j]));
+        REQUIRE(v.disjoint(w) == clades[i].disjoint(clades[j]));
+        REQUIRE((v == w) == (clades[i] == clades[j]));
+      }
+    }
+  }
+}
+
+TEST_CASE("Views hash like the clades they show") {
+  TaxonSet ts = make_taxa(100);
+  BitMatrix m(ts);
+  Clade a(ts), b(ts);
+  a.add(3);
+  a.add(70);
+  b.add(70);
+  b.add(3);
+  m.add(a);
+  m.add(b);
+  std::unordered_set<CladeView> views;
+  views.insert(m.view(0));
+  REQUIRE(views.count(m.view(1)));
+  m.intersect(Clade(ts, 70));
+  REQUIRE(m.view(0).size() == 1);
+  REQUIRE(m.view(0).contains(70));
+}
+
+TEST_CASE("Clade sizes count each taxon once") {
+  TaxonSet ts = make_taxa(10);
+  Clade c(ts);
+  c.add(2);
+  c.add(2);
+  REQUIRE(c.size() == 1);
+  c.remove(5);
+  REQUIRE(c.size() == 1);
+  REQUIRE(Clade(ts, std::unordered_set<Taxon>{1, 4}).size() == 2);
+}
+
+TEST_CASE("DisjointSet keeps the clusters as rows") {
+  TaxonSet ts = make_taxa(200);
+  DisjointSet sets(200, ts);
+  for (int i = 0; i + 1 < 200; i += 2) {
+    sets.merge(i, i + 1);
+  }
+  sets.merge(0, 150);
+  CladeView c = sets.clade(sets.find(0));
+  REQUIRE(c.size() == 4);
+  REQUIRE(c.contains(0));
+  REQUIRE(c.contains(1));
+  REQUIRE(c.contains(150));
+  REQUIRE(c.contains(151));
+  REQUIRE(sets.clade(sets.find(77)).size() == 2);
+}
@@ -0,0 +1,89 @@
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/DistanceMatrix.hpp"
+#include "phylokit/IntervalClade.hpp"
+#include "phylokit/TreeGenerator.hpp"
+#include "phylokit/newick.hpp"
+#include "test/fixtures.hpp"
+
+namespace {
+
+// The deepest node whose clade holds both taxa, by the nodes' bit vectors.
+int brute_lca(const Tree &tree, Taxon a, Taxon b) {
+  int best = 0;
+  for (int n = 0; n < tree.size(); n++) {
+    const TreeClade &tc = tree.node(n);
+    if (tc.contains(a) && tc.contains(b) &&
+        tree.node(best).contains(tc)) {
+      best = n;
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+TEST_CASE("Intervals agree with the clades of the tree") {
+  TaxonSet ts = make_taxa(60);
+  TreeGenerator gen(ts, 5);
+  SimTree polytomies = gen.yule();
+  gen.collapse(polytomies, 0.4);
+  SimTree trees[] = {gen.yule(), gen.caterpillar(), polytomies};
+  for (const SimTree &sim : trees) {
+    Tree tree = gen.to_tree(sim, ts);
+    TreeIntervals iv(tree);
+    REQUIRE(iv.leaf_order() == tree.leaf_order());
+    REQUIRE(iv.root() == IntervalClade(0, 59));
+    for (int p = 0; p < 60; p++) {
+      REQUIRE(iv.position(iv.taxon(p)) == p);
+    }
+    for (int a = 0; a < tree.size(); a++) {
+      const Clade &ca = tree.node(a);
+      REQUIRE(iv[a].size() == ca.size());
+      REQUIRE(iv.to_clade(a) == ca);
+      for (Taxon t = 0; t < 60; t++) {
+        REQUIRE(iv.contains(a, t) == ca.contains(t));
+      }
+      for (int b = 0; b < tree.size(); b++) {
+        const Clade &cb = tree.node(b);
+        REQUIRE(iv[a].contains(iv[b]) == ca.contains(cb));
+        REQUIRE(iv[a].overlap_size(iv[b]) == ca.overlap_size(cb));
+        REQUIRE(iv[a].disjoint(iv[b]) == ca.disjoint(cb));
+        REQUIRE(iv[a].relation(iv[b]) == ca.relation(cb));
+        REQUIRE((iv[a] == iv[b]) == (ca == cb));
+      }
+    }
+  }
+}
+
+TEST_CASE("Positions are taxa after renumbering by the leaf order") {
+  TaxonSet ts("a,b,c,d,e");
+  Tree tree = newick_to_treeclades("((c, (a, e)), (d, b))", ts);
+  tree.renumber(ts.renumber(tree.leaf_order()));
+  TreeIntervals iv(tree);
+  for (int p = 0; p < 5; p++) {
+    REQUIRE(iv.taxon(p) == p);
+  }
+  REQUIRE(iv.to_clade(IntervalClade(1, 2)) ==
+          Clade(ts, std::unordered_set<Taxon>{ts["a"], ts["e"]}));
+}
+
+TEST_CASE("LCA finds the deepest common ancestor") {
+  TaxonSet ts = make_taxa(40);
+  TreeGenerator gen(ts, 8);
+  SimTree polytomies = gen.yule();
+  gen.collapse(polytomies, 0.5);
+  SimTree trees[] = {gen.yule(), gen.caterpillar(), polytomies};
+  for (const SimTree &sim : trees) {
+    Tree tree = gen.to_tree(sim, ts);
+    DistanceMatrix lca(ts);
+    tree.LCA(lca);
+    for (Taxon a = 0; a < 40; a++) {
+      for (Taxon b = a; b < 40; b++) {
+        REQUIRE(lca(a, b) == brute_lca(tree, a, b));
+      }
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#include <random>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/TaxonCounter.hpp"
+
+TEST_CASE("Bit-sliced counts match counting members") {
+  std::mt19937 rng(11);
+  for (size_t size : {1, 63, 64, 300, 5000, 100000}) {
+    std::bernoulli_distribution dense(0.3);
+    std::uniform_int_distribution<size_t> taxon(0, size - 1);
+    TaxonCounter counter(size);
+    std::vector<uint32_t> expected(size, 0);
+    for (int i = 0; i < 100; i++) {
+      BitVectorFixed bits(size);
+      if (i % 3) {
+        for (size_t t = 0; t < size; t++) {
+          if (dense(rng)) bits.set(t);
+        }
+      } else {
+        for (int k = 0; k < 5; k++) {
+          bits.set(taxon(rng));
+        }
+      }
+      for (int t : bits) {
+        expected[t]++;
+      }
+      counter.add(bits);
+      if (i % 17 == 0) {
+        REQUIRE(counter.counts() == expected);
+      }
+    }
+    REQUIRE(counter.added() == 100);
+    REQUIRE(counter.counts() == expected);
+  }
+}
+
+TEST_CASE("Counts reach the number of vectors added") {
+  TaxonCounter counter(130);
+  BitVectorFixed all(130), none(130);
+  for (int t = 0; t < 130; t++) {
+    all.set(t);
+  }
+  for (int i = 0; i < 1000; i++) {
+    counter.add(i % 2 ? none : all);
+  }
+  counter.add(all);
+  REQUIRE(counter.counts() == std::vector<uint32_t>(130, 501));
+}
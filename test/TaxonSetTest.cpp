@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch2.hpp"
+#include "phylokit/TaxonSet.hpp"
+
+namespace {
+std::vector<std::string> make_names(int n) {
+  std::vector<std::string> names;
+  for (int i = 0; i < n; i++) {
+    // Some names longer than a hash word, some sharing long prefixes.
+    names.push_back(i % 3 ? "t" + std::to_string(i)
+                          : "Homo_sapiens_population_" + std::to_string(i));
+  }
+  return names;
+}
+}  // namespace
+
+TEST_CASE("Taxa are numbered in the order they are added") {
+  for (int n : {0, 1, 5, 1000, 100000}) {
+    std::vector<std::string> names = make_names(n);
+    TaxonSet ts(n);
+    for (int i = 0; i < n; i++) {
+      REQUIRE(ts.add(names[i]) == i);
+    }
+    for (int frozen = 0; frozen < 2; frozen++) {
+      REQUIRE(ts.size() == (size_t) n);
+      for (int i = 0; i < n; i++) {
+        REQUIRE(ts[names[i]] == i);
+        REQUIRE(ts.find(names[i].data(), names[i].size()) == i);
+        REQUIRE(ts[i] == names[i]);
+        REQUIRE(ts.get(i).str() == names[i]);
+        REQUIRE(std::string(ts[i].c_str()) == names[i]);
+      }
+      REQUIRE(!ts.has("missing"));
+      REQUIRE(!ts.has(""));
+      REQUIRE(ts.find("t", 1) == -1);
+      ts.freeze();
+      REQUIRE(ts.is_frozen());
+    }
+  }
+}
+
+TEST_CASE("Taxon sets start small and grow") {
+  // As many taxa as fit the one word of taxa_bs.
+  TaxonSet ts(2);
+  std::vector<std::string> names = make_names(64);
+  for (const std::string &name : names) {
+    ts[name];
+  }
+  REQUIRE(ts.size() == 64);
+  REQUIRE(ts.taxa_bs.popcount() == 64);
+  REQUIRE(ts.add(names[7]) == 7);
+  REQUIRE(ts.size() == 64);
+}
+
+TEST_CASE("Names stay put when a set grows or moves") {
+  TaxonSet ts(1001);
+  ts.add("first");
+  TaxonName name = ts.get(0);
+  for (const std::string &n : make_names(1000)) {
+    ts.add(n);
+  }
+  TaxonSet moved(std::move(ts));
+  REQUIRE(moved.get(0).data() == name.data());
+  REQUIRE(name == std::string("first"));
+}
+
+TEST_CASE("Const lookups of unknown names throw") {
+  TaxonSet ts(3);
+  ts.add("a");
+  const TaxonSet &cts = ts;
+  REQUIRE(cts["a"] == 0);
+  REQUIRE_THROWS_AS(cts["b"], std::out_of_range);
+  ts.freeze();
+  REQUIRE_THROWS_AS(cts["b"], std::out_of_range);
+}
+
+TEST_CASE("Taxon sets read from clades") {
+  TaxonSet ts(std::string("{c,a}\n{b,a}\n"));
+  REQUIRE(ts.size() == 3);
+  REQUIRE(ts.has("a"));
+  REQUIRE(ts.has("b"));
+  REQUIRE(ts.has("c"));
+  std::vector<std::string> sorted = ts.sort_taxa();
+  REQUIRE(sorted == std::vector<std::string>({"a", "b", "c"}));
+  REQUIRE(ts.str().find("\ta\n") != std::string::npos);
+}
+
+namespace {
+// Each thread adds every name in its own order and checks the numbers it
+// gets back; the set is canonicalized after they have all finished.
+void add_in_parallel(TaxonSet &ts, const std::vector<std::string> &names,
+                     int nthreads,
+                     std::vector<std::vector<Taxon>> &numbers) {
+  numbers.assign(nthreads, std::vector<Taxon>(names.size()));
+  std::vector<std::thread> threads;
+  for (int k = 0; k < nthreads; k++) {
+    threads.emplace_back([&, k]() {
+      std::vector<size_t> order(names.size());
+      for (size_t i = 0; i < order.size(); i++) order[i] = i;
+      std::shuffle(order.begin(), order.end(), std::mt19937(k));
+      for (size_t i : order) {
+        numbers[k][i] = ts.add(names[i]);
+      }
+      for (size_t i : order) {
+        if (ts.find(names[i].data(), names[i].size()) != numbers[k][i]) {
+          numbers[k][i] = -2;
+        }
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+}
+}  // namespace
+
+TEST_CASE("Threads can add to a concurrent set") {
+  std::vector<std::string> names = make_names(5000);
+  std::vector<std::string> sorted(names.begin() + 10, names.end());
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::vector<Taxon>> expected;
+
+  for (int run = 0; run < 2; run++) {
+    TaxonSet ts(names.size());
+    for (int i = 0; i < 10; i++) {
+      ts.add(names[i]);
+    }
+    ts.make_concurrent();
+    REQUIRE(ts.is_concurrent());
+    std::vector<std::vector<Taxon>> numbers;
+    add_in_parallel(ts, names, 8, numbers);
+    REQUIRE(ts.size() == names.size());
+    // Every thread got the same number for a name.
+    for (int k = 1; k < 8; k++) {
+      REQUIRE(numbers[k] == numbers[0]);
+    }
+
+    std::vector<Taxon> order = ts.canonicalize();
+    REQUIRE(!ts.is_concurrent());
+    REQUIRE(ts.size() == names.size());
+    REQUIRE(ts.taxa_bs.popcount() == (int) names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+      Taxon t = order[numbers[0][i]];
+      REQUIRE(ts[names[i]] == t);
+      REQUIRE(ts.get(t) == names[i]);
+    }
+    // The taxa from before keep their numbers and the new ones go by name.
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(ts[names[i]] == i);
+    }
+    for (size_t i = 0; i < sorted.size(); i++) {
+      REQUIRE(ts.get(10 + i) == sorted[i]);
+    }
+    ts.freeze();
+    REQUIRE(ts[names[42]] == ts.find(names[42].data(), names[42].size()));
+  }
+}
+
+TEST_CASE("Concurrent sets hold as many taxa as they were made for") {
+  TaxonSet ts(2);
+  ts.make_concurrent();
+  ts.add("a");
+  ts.add("b");
+  REQUIRE(ts.add("a") == 0);
+  REQUIRE_THROWS_AS(ts.add("c"), std::length_error);
+  REQUIRE(ts.size() == 2);
+  ts.canonicalize();
+  REQUIRE(ts["b"] == 1);
+
+  // A second round keeps the first round's names.
+  TaxonSet more(4);
+  more.make_concurrent();
+  more.add("y");
+  more.add("x");
+  more.canonicalize();
+  more.make_concurrent();
+  more.add("w");
+  REQUIRE(more.add("x") == 0);
+  more.canonicalize();
+  REQUIRE(more.get(0) == std::string("x"));
+  REQUIRE(more.get(1) == std::string("y"));
+  REQUIRE(more.get(2) == std::string("w"));
+}
+
+TEST_CASE("Taxa can be renumbered") {
+  for (int frozen = 0; frozen < 2; frozen++) {
+    TaxonSet ts(5);
+    for (const char *name : {"a", "b", "c", "d", "e"}) {
+      ts.add(name);
+    }
+    if (frozen) ts.freeze();
+    std::vector<Taxon> order = ts.renumber({3, 1});
+    REQUIRE(order == std::vector<Taxon>({2, 1, 3, 0, 4}));
+    REQUIRE(ts["d"] == 0);
+    REQUIRE(ts["b"] == 1);
+    REQUIRE(ts["a"] == 2);
+    REQUIRE(ts["c"] == 3);
+    REQUIRE(ts["e"] == 4);
+    REQUIRE(ts.get(0) == std::string("d"));
+    REQUIRE(ts.is_frozen() == (frozen == 1));
+  }
+}
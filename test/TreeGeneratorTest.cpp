@@ -0,0 +1,148 @@
+#include <string>
+#include <unordered_set>
+#include "catch2.hpp"
+#include "phylokit/TreeGenerator.hpp"
+#include "phylokit/newick.hpp"
+#include "test/fixtures.hpp"
+
+namespace {
+
+size_t count_leaves(const SimTree &tree) {
+  size_t n = 0;
+  for (Taxon t : tree.taxon) {
+    n += t >= 0;
+  }
+  return n;
+}
+
+// Clades of the internal nodes of the tree read back from its newick.
+size_t count_clades(const std::string &newick, TaxonSet &ts) {
+  std::unordered_set<Clade> clades;
+  newick_to_clades(newick, ts, clades);
+  return clades.size();
+}
+
+}  // namespace
+
+TEST_CASE("Generated trees are binary over all taxa") {
+  TaxonSet ts = make_taxa(50);
+  TreeGenerator gen(ts, 3);
+  SimTree species = gen.yule();
+  SimTree trees[] = {species, gen.caterpillar(), gen.coalescent(species)};
+  for (const SimTree &tree : trees) {
+    REQUIRE(count_leaves(tree) == 50);
+    REQUIRE(tree.size() == 99);
+    std::vector<int> first, kids, order;
+    tree.children(first, kids);
+    tree.top_down(first, kids, order);
+    REQUIRE(order.size() == 99);
+    std::string newick;
+    gen.write_newick(tree, newick, true);
+    REQUIRE(count_clades(newick, ts) == 49);
+  }
+}
+
+TEST_CASE("Branch lengths are nonnegative and gene trees ultrametric") {
+  TaxonSet ts = make_taxa(30);
+  TreeGenerator gen(ts, 5);
+  SimTree species = gen.yule();
+  SimTree gene = gen.coalescent(species, 0.5);
+  for (const SimTree *tree : {&species, &gene}) {
+    std::vector<int> first, kids, order;
+    tree->children(first, kids);
+    tree->top_down(first, kids, order);
+    std::vector<double> depth(tree->size(), 0);
+    double leaf_depth = -1;
+    for (int v : order) {
+      REQUIRE(tree->length[v] >= 0);
+      if (v != tree->root) {
+        depth[v] = depth[tree->parent[v]] + tree->length[v];
+      }
+      if (tree->taxon[v] >= 0) {
+        if (leaf_depth < 0) leaf_depth = depth[v];
+        REQUIRE(depth[v] == Approx(leaf_depth));
+      }
+    }
+  }
+}
+
+TEST_CASE("Trees over no taxa are empty") {
+  TaxonSet ts(0);
+  TreeGenerator gen(ts, 1);
+  SimTree species = gen.yule();
+  REQUIRE(species.size() == 0);
+  REQUIRE(species.root < 0);
+  SimTree gene = gen.coalescent(species);
+  REQUIRE(gene.size() == 0);
+  std::string newick;
+  gen.write_newick(species, newick, true);
+  REQUIRE(newick == ";");
+}
+
+TEST_CASE("A seed reproduces the same trees") {
+  TaxonSet ts = make_taxa(40);
+  std::string a, b;
+  for (std::string *out : {&a, &b}) {
+    TreeGenerator gen(ts, 42);
+    SimTree species = gen.yule();
+    for (int i = 0; i < 10; i++) {
+      SimTree tree = gen.coalescent(species);
+      gen.drop_taxa(tree, 0.2);
+      gen.collapse(tree, 0.2);
+      gen.write_newick(tree, *out, true);
+    }
+  }
+  REQUIRE(a == b);
+  TreeGenerator other(ts, 43);
+  std::string c;
+  other.write_newick(other.yule(), c, true);
+  REQUIRE(a.compare(0, c.size(), c) != 0);
+}
+
+TEST_CASE("Dropping taxa and collapsing branches") {
+  TaxonSet ts = make_taxa(200);
+  TreeGenerator gen(ts, 9);
+
+  SimTree tree = gen.yule();
+  gen.drop_taxa(tree, 0.5);
+  size_t leaves = count_leaves(tree);
+  REQUIRE(leaves > 50);
+  REQUIRE(leaves < 150);
+  // Still binary: nodes with one child are suppressed.
+  REQUIRE(tree.size() == 2 * leaves - 1);
+
+  SimTree few = gen.caterpillar();
+  gen.drop_taxa(few, 1);
+  REQUIRE(count_leaves(few) == 4);
+  REQUIRE(few.size() == 7);
+
+  SimTree star = gen.yule();
+  gen.collapse(star, 1);
+  REQUIRE(star.size() == 201);
+  std::string newick;
+  gen.write_newick(star, newick, false);
+  REQUIRE(count_clades(newick, ts) == 1);
+
+  SimTree some = gen.caterpillar();
+  gen.collapse(some, 0.5);
+  REQUIRE(count_leaves(some) == 200);
+  REQUIRE(some.size() > 201);
+  REQUIRE(some.size() < 399);
+}
+
+TEST_CASE("Simulated trees convert to Trees") {
+  TaxonSet ts = make_taxa(20);
+  TreeGenerator gen(ts, 1);
+  SimTree sim = gen.yule();
+  gen.collapse(sim, 0.3);
+  Tree tree = gen.to_tree(sim, ts);
+  REQUIRE((size_t) tree.size() == sim.size());
+  REQUIRE(tree.node(0).size() == 20);
+  std::string newick;
+  gen.write_newick(sim, newick, false);
+  std::unordered_set<Clade> expected;
+  newick_to_clades(newick, ts, expected);
+  for (size_t i = 0; i < sim.size(); i++) {
+    if (tree.node(i).size() > 1) REQUIRE(expected.count(tree.node(i)));
+  }
+}
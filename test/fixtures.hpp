@@ -0,0 +1,48 @@
+#ifndef TEST_FIXTURES_HPP__
+#define TEST_FIXTURES_HPP__
+
+#include <string>
+
+#include "phylokit/TaxonSet.hpp"
+
+// Inputs shared by the tests: taxa named t0, t1, ..., t(n-1) and fixed
+// trees over them in newick.
+
+// "t0,t1,...", for TaxonSet's and Clade's string constructors.
+inline std::string taxa_list(int n) {
+  std::string s;
+  for (int i = 0; i < n; i++) {
+    s += (i ? ",t" : "t") + std::to_string(i);
+  }
+  return s;
+}
+
+// A TaxonSet with room for exactly the n taxa, added in order.
+inline TaxonSet make_taxa(int n) {
+  TaxonSet ts(n);
+  for (int i = 0; i < n; i++) {
+    ts.add("t" + std::to_string(i));
+  }
+  return ts;
+}
+
+// A caterpillar over the n taxa, joined in the order 0, step, 2 * step, ...
+// modulo n; step has to be coprime to n.
+inline std::string caterpillar(int n, int step = 1) {
+  std::string s = "t0";
+  for (int i = 1; i < n; i++) {
+    s = "(" + s + ",t" + std::to_string((i * step) % n) + ")";
+  }
+  return s + ";";
+}
+
+// A balanced tree over t(lo) .. t(hi - 1), without the ';'.
+inline std::string balanced(int lo, int hi) {
+  if (hi - lo == 1) {
+    return "t" + std::to_string(lo);
+  }
+  int mid = (lo + hi) / 2;
+  return "(" + balanced(lo, mid) + "," + balanced(mid, hi) + ")";
+}
+
+#endif  // TEST_FIXTURES_HPP__
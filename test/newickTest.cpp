@@ -62,6 +62,16 @@ TEST_CASE("newick_to_ts") {
   }
 }
 
+TEST_CASE("newick_to_ts into a TaxonSet") {
+  TaxonSet ts(6);
+  REQUIRE(newick_to_ts("(a:4.3, (b, (c, d):12):3.23)I3", ts) == 4);
+  REQUIRE(newick_to_ts("((e, b), first taxon)", ts) == 3);
+  REQUIRE(ts.size() == 6);
+  REQUIRE(ts["a"] == 0);
+  REQUIRE(ts["e"] == 4);
+  REQUIRE(ts["first taxon"] == 5);
+}
+
 TEST_CASE("newick_to_taxa") {
   TaxonSet ts(
       "a,b,c,d,e,f,g,first taxon,second taxon,third taxon,\"fourth taxon\"");
@@ -105,6 +115,32 @@ TEST_CASE("newick_to_clades") {
   }
 }
 
+TEST_CASE("newick_to_splits") {
+  TaxonSet ts("a,b,c,d,e,f");
+  Clade taxa(ts, "a,b,c,d,e,f");
+  std::unordered_set<Split> split_set;
+  SECTION("Rooting does not change the splits") {
+    std::unordered_set<Split> rerooted;
+    newick_to_splits("((a, b), ((c, d), (e, f)))", ts, split_set);
+    newick_to_splits("(((a, b), (c, d)), (e, f))", ts, rerooted);
+    REQUIRE(split_set == rerooted);
+    REQUIRE(split_set == std::unordered_set<Split>{
+                             Split(Clade(ts, "a,b"), taxa),
+                             Split(Clade(ts, "c,d"), taxa),
+                             Split(Clade(ts, "e,f"), taxa)});
+  }
+  SECTION("Both sides give the same split") {
+    newick_to_splits("(a, b, (c, (d, (e, f))))", ts, split_set);
+    REQUIRE(split_set.count(Split(Clade(ts, "a,b,c"), taxa)));
+    REQUIRE(split_set.count(Split(Clade(ts, "d,e,f"), taxa)));
+    Split split(Clade(ts, "a,b,c"), taxa);
+    REQUIRE(split == Split(Clade(ts, "d,e,f"), taxa));
+    REQUIRE(!split.side().contains(taxa.get_taxa().ffs()));
+    REQUIRE(split.other_side(taxa).contains(taxa.get_taxa().ffs()));
+    REQUIRE(split_set.size() == 3);
+  }
+}
+
 TEST_CASE("newick_to_treeclades") {
   TaxonSet ts("a,b,c,d,e,f");
 
@@ -117,11 +153,11 @@ TEST_CASE("newick_to_treeclades") {
     CHECK(tree.root().child(1) == Clade(ts, "b,c,d,e"));
     CHECK(tree.root().child(1).child(0) == Clade(ts, "b,c"));
     CHECK(tree.root().child(1).child(1) == Clade(ts, "d,e"));
-    CHECK(tree.clades.size() == 9);
+    CHECK(tree.size() == 9);
     
-    for (auto& c_it : tree.clades) {
-      for (int i = 0; i < c_it.second.nchildren(); i++) {
-        CHECK(c_it.second.child(i).parent == c_it.first);
+    for (int n = 0; n < tree.size(); n++) {
+      for (int i = 0; i < tree.node(n).nchildren(); i++) {
+        CHECK(tree.node(n).child(i).parent() == n);
       }
     }
   }
@@ -134,9 +170,9 @@ TEST_CASE("newick_to_treeclades") {
     CHECK(tree.root().child(1) == Clade(ts, "b,c"));
     CHECK(tree.root().child(2) == Clade(ts, "d,e"));
 
-    for (auto& c_it : tree.clades) {
-      for (int i = 0; i < c_it.second.nchildren(); i++) {
-        CHECK(c_it.second.child(i).parent == c_it.first);
+    for (int n = 0; n < tree.size(); n++) {
+      for (int i = 0; i < tree.node(n).nchildren(); i++) {
+        CHECK(tree.node(n).child(i).parent() == n);
       }
     }
   }
@@ -200,4 +236,185 @@ TEST_CASE("unmap_clade_names") {
   SECTION("Simple case") {
     REQUIRE(unmap_clade_names("{1,2,3}", ts) == "{b,c,d}");
   }
-}
\ No newline at end of file
+}
+TEST_CASE("RFDist") {
+  TaxonSet ts("a,b,c,d,e,f,g");
+  Tree t1 = newick_to_treeclades("((a, b), ((c, d), (e, f)))", ts);
+  Tree t2 = newick_to_treeclades("(((a, b), (c, d)), (e, f))", ts);
+  Tree t3 = newick_to_treeclades("(((a, c), (b, d)), ((e, f), g))", ts);
+
+  REQUIRE(t1.RFDist(t2, false) == 1);
+  REQUIRE(t1.RFDist(t2, false, true) == 0);
+  REQUIRE(t1.splits() == t2.splits());
+  // On the taxa shared with t1, t3 has the splits ac|bdef, bd|acef and
+  // ef|abcd.
+  REQUIRE(t1.RFDist(t3, false, true) == 2);
+  REQUIRE(t1.RFDist(t3, true, true) == Approx(2.0 / 3));
+}
+
+TEST_CASE("Renumbering taxa by the leaves of a tree") {
+  TaxonSet ts("a,b,c,d,e,f,g");
+  std::string ref = "((g, c), ((a, f), (e, (b, d))))";
+  std::string other = "(((g, a), c), ((f, e), (b, d)))";
+  Tree t1 = newick_to_treeclades(ref, ts);
+  Tree t2 = newick_to_treeclades(other, ts);
+  std::unordered_set<Clade> clades;
+  newick_to_clades(other, ts, clades);
+  DistanceMatrix dm(ts, other);
+  double rf = t1.RFDist(t2, false);
+
+  std::vector<Taxon> leaves = t1.leaf_order();
+  REQUIRE(leaves.size() == 7);
+  std::vector<Taxon> order = ts.renumber(leaves);
+  t1.renumber(order);
+  t2.renumber(order);
+  dm.renumber(order);
+
+  // The leaves of the reference now run 0, 1, 2, ... and its clades are
+  // ranges of taxa.
+  for (int i = 0; i < 7; i++) {
+    REQUIRE(t1.leaf_order()[i] == i);
+  }
+  REQUIRE(ts.get(0) == std::string("g"));
+  REQUIRE(ts["d"] == 6);
+  for (int n = 0; n < t1.size(); n++) {
+    const Clade &c = t1.node(n);
+    int lo = c.get_taxa().ffs();
+    REQUIRE(c.size() > 0);
+    for (int i = 0; i < c.size(); i++) {
+      REQUIRE(c.contains(lo + i));
+    }
+  }
+
+  // Renumbered trees and matrices match those read with the new numbers.
+  Tree t2_again = newick_to_treeclades(other, ts);
+  for (int n = 0; n < t2.size(); n++) {
+    REQUIRE(t2.node(n) == t2_again.node(n));
+  }
+  std::unordered_set<Clade> renumbered, clades_again;
+  for (Clade c : clades) {
+    c.renumber(order);
+    renumbered.insert(c);
+  }
+  newick_to_clades(other, ts, clades_again);
+  REQUIRE(renumbered == clades_again);
+  DistanceMatrix dm_again(ts, other);
+  for (Taxon i = 0; i < 7; i++) {
+    for (Taxon j = 0; j < 7; j++) {
+      REQUIRE(dm(i, j) == dm_again(i, j));
+      REQUIRE(dm.masked(i, j) == dm_again.masked(i, j));
+    }
+  }
+  REQUIRE(t1.RFDist(t2, false) == rf);
+}
+
+TEST_CASE("Renumbering sparse clades") {
+  const int n = 5000;
+  std::string names, newick = "t0";
+  for (int i = 0; i < n; i++) {
+    names += (i ? ",t" : "t") + std::to_string(i);
+  }
+  // A caterpillar whose leaves run t4999, t4998, ..., t0.
+  for (int i = 1; i < n; i++) {
+    newick = "(t" + std::to_string(i) + "," + newick + ")";
+  }
+  TaxonSet ts(names);
+  Tree tree = newick_to_treeclades(newick, ts);
+  Clade small(ts, "t0,t1,t2");
+  std::vector<Taxon> order = ts.renumber(tree.leaf_order());
+  small.renumber(order);
+  REQUIRE(small.get_taxa().is_sparse());
+  REQUIRE(small == Clade(ts, "t0,t1,t2"));
+  REQUIRE(ts["t0"] == n - 1);
+  REQUIRE(small.contains(n - 3));
+}
+
+TEST_CASE("Trees keep their links and lengths in columns") {
+  TaxonSet ts("a,b,c,d,e");
+  Tree tree = newick_to_treeclades("(a:1.5, (b:2, c:0.25)I1:3, (d, e):4)", ts);
+  REQUIRE(tree.has_lengths());
+  REQUIRE(tree.size() == 8);
+  REQUIRE(tree.parent(0) == -1);
+  std::vector<int> kids;
+  for (int c : tree.children(0)) {
+    kids.push_back(c);
+    REQUIRE(tree.parent(c) == 0);
+  }
+  REQUIRE(kids.size() == 3);
+  REQUIRE(tree.last_child(0) == kids[2]);
+  REQUIRE(tree.taxon(kids[0]) == ts["a"]);
+  REQUIRE(tree.taxon(kids[1]) == -1);
+  REQUIRE(tree.length(kids[0]) == 1.5);
+  REQUIRE(tree.length(kids[1]) == 3);
+  REQUIRE(tree.length(kids[2]) == 4);
+  REQUIRE(tree.length(tree.first_child(kids[1])) == 2);
+  REQUIRE(tree.length(tree.last_child(kids[1])) == 0.25);
+  REQUIRE(tree.length(tree.first_child(kids[2])) == 0);
+  REQUIRE_FALSE(newick_to_treeclades("(a, (b, c))", ts).has_lengths());
+
+  // Copies take the links but compute their own clades.
+  tree.root();
+  Tree copy(tree);
+  REQUIRE_FALSE(copy.has_clades());
+  REQUIRE(copy.size() == tree.size());
+  for (int n = 0; n < tree.size(); n++) {
+    REQUIRE(copy.length(n) == tree.length(n));
+    REQUIRE(copy.node(n) == tree.node(n));
+    REQUIRE(copy.node(n).tree == &copy);
+    REQUIRE(copy.parent(n) == tree.parent(n));
+    REQUIRE(copy.next_sibling(n) == tree.next_sibling(n));
+    REQUIRE(copy.taxon(n) == tree.taxon(n));
+  }
+}
+
+TEST_CASE("Swapping and rerooting relink the nodes") {
+  TaxonSet ts("a,b,c,d,e,f");
+  Tree tree = newick_to_treeclades("((a, b), (c, d), (e, f))", ts);
+  int ab = tree.root().child(0).index, cd = tree.root().child(1).index;
+  // Siblings next to each other, then nodes under different parents.
+  tree.swap(ab, cd);
+  REQUIRE(tree.root().child(0).index == cd);
+  REQUIRE(tree.root().child(1).index == ab);
+  int a = tree.node(ab).child(0).index, ef = tree.last_child(0);
+  tree.swap(a, ef);
+  REQUIRE(tree.parent(ef) == ab);
+  REQUIRE(tree.parent(a) == 0);
+  REQUIRE(tree.last_child(0) == a);
+  REQUIRE(tree.first_child(ab) == ef);
+
+  // The clades above swapped nodes change, so swap() drops them.
+  Tree built = newick_to_treeclades("((a,b),(c,d))", ts);
+  built.root();
+  int leaf_a = built.node(built.first_child(0)).child(0).index;
+  int leaf_c = built.node(built.last_child(0)).child(0).index;
+  built.swap(leaf_a, leaf_c);
+  REQUIRE_FALSE(built.has_clades());
+  REQUIRE(built.root().verify());
+  REQUIRE(built.node(built.first_child(0)) == Clade(ts, "c,b"));
+  // rotate() updates the one clade that changes instead.
+  built.rotate(0, 0);
+  REQUIRE(built.has_clades());
+  REQUIRE(built.root().verify());
+  REQUIRE(built.root().child(0) == Clade(ts, "b,a,d"));
+
+  Tree rooted = newick_to_treeclades("((a, b), (c, d), (e, f))", ts);
+  Tree original(rooted);
+  rooted.reroot(ts["e"]);
+  REQUIRE(rooted.root().verify());
+  REQUIRE(rooted.root().nchildren() == 2);
+  REQUIRE((rooted.root().child(0) == Clade(ts, "e") ||
+           rooted.root().child(1) == Clade(ts, "e")));
+  REQUIRE(rooted.RFDist(original, false, true) == 0);
+
+  // Rerooting updates clades already computed, and computes none itself.
+  Tree eager = newick_to_treeclades("((a, b), (c, d), (e, f))", ts);
+  Tree lazy_clades(eager);
+  eager.root();
+  eager.reroot(ts["c"]);
+  lazy_clades.reroot(ts["c"]);
+  REQUIRE_FALSE(lazy_clades.has_clades());
+  REQUIRE(eager.root().verify());
+  for (int n = 0; n < eager.size(); n++) {
+    REQUIRE(eager.node(n) == lazy_clades.node(n));
+  }
+}